@@ -0,0 +1,174 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Короткая пауза в цикле ожидания, чтобы не забивать соседний гиперпоток
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Барьер с обращением смысла (sense-reversing): последний пришедший поток
+// сбрасывает счётчик и переключает sense, остальные крутятся на чтении
+// sense. Вместо bool sense хранится номер фазы (его чётность - обычный
+// sense): поток, который проспал переключение, не спутает следующую фазу со
+// своей, если за это время sense успел переключиться обратно. Ожидаемая фаза
+// берётся из текущего значения до уменьшения счётчика, поэтому число
+// участников можно менять между фазами, пока барьер никто не проходит.
+class SpinBarrier
+{
+public:
+    explicit SpinBarrier(int count = 1) : count_(count), remaining_(count), phase_(0) {}
+
+    void reset(int count)
+    {
+        count_ = count;
+        remaining_.store(count, std::memory_order_relaxed);
+    }
+
+    void arrive_and_wait()
+    {
+        unsigned long my_phase = phase_.load(std::memory_order_relaxed);
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            remaining_.store(count_, std::memory_order_relaxed);
+            phase_.store(my_phase + 1, std::memory_order_release);
+            return;
+        }
+        // Сначала чистое ожидание; если барьер затянулся (потоков больше, чем
+        // ядер), поток начинает уступать процессор
+        for (int spins = 0; phase_.load(std::memory_order_acquire) == my_phase; ++spins) {
+            if (spins < spin_limit)
+                cpu_relax();
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    static const int spin_limit = 4096;
+
+private:
+    int count_;
+    std::atomic<int> remaining_;
+    std::atomic<unsigned long> phase_;
+};
+
+// Пул из max_threads - 1 постоянных потоков; вызывающий поток работает как
+// участник 0. parallel_for(num_threads, begin, end, fn) режет [begin, end) на
+// num_threads равных блоков (остаток - последнему), как это раньше делалось
+// вручную, и вызывает fn(start, end) для каждого блока. Блок t всегда
+// достаётся одному и тому же потоку, поэтому фазы с одинаковым разбиением
+// (инициализация и умножение) работают с памятью, которой коснулись сами.
+// Незанятые потоки немного крутятся, а потом засыпают на condition_variable.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int max_threads) : max_threads_(max_threads)
+    {
+        for (int id = 1; id < max_threads; ++id)
+            workers_.emplace_back(&ThreadPool::worker_loop, this, id);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            ticket_.fetch_add(1 << active_bits, std::memory_order_release);
+        }
+        wake_.notify_all();
+        for (auto &t : workers_)
+            t.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int size() const { return max_threads_; }
+
+    void parallel_for(int num_threads, int begin, int end, const std::function<void(int, int)> &fn)
+    {
+        if (num_threads > max_threads_)
+            num_threads = max_threads_;
+        if (num_threads > end - begin)
+            num_threads = end - begin;
+        if (num_threads <= 1) {
+            fn(begin, end);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &fn;
+            begin_ = begin;
+            end_ = end;
+            barrier_.reset(num_threads);
+            unsigned long generation = (ticket_.load(std::memory_order_relaxed) >> active_bits) + 1;
+            ticket_.store(generation << active_bits | num_threads, std::memory_order_release);
+        }
+        wake_.notify_all();
+
+        run_block(0, num_threads);
+        barrier_.arrive_and_wait();
+    }
+
+private:
+    void run_block(int id, int active)
+    {
+        int block = (end_ - begin_) / active;
+        int start_idx = begin_ + id * block;
+        int end_idx = (id == active - 1) ? end_ : start_idx + block;
+        (*job_)(start_idx, end_idx);
+    }
+
+    void worker_loop(int id)
+    {
+        unsigned long seen = 0;
+        while (true) {
+            for (int spins = 0; spins < SpinBarrier::spin_limit; ++spins) {
+                if (ticket_.load(std::memory_order_acquire) != seen)
+                    break;
+                cpu_relax();
+            }
+            if (ticket_.load(std::memory_order_acquire) == seen) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return ticket_.load(std::memory_order_acquire) != seen; });
+            }
+            seen = ticket_.load(std::memory_order_acquire);
+
+            if (stop_)
+                return;
+            // Остальные поля задания читают только участники: пока они не
+            // прошли барьер, вызывающий поток не начнёт следующее задание
+            int active = (int)(seen & ((1u << active_bits) - 1));
+            if (id < active) {
+                run_block(id, active);
+                barrier_.arrive_and_wait();
+            }
+        }
+    }
+
+    int max_threads_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    // Номер задания в старших битах и число участников в младших: неучастник
+    // узнаёт, что задание не его, из одного атомарного чтения
+    static const int active_bits = 16;
+    std::atomic<unsigned long> ticket_{0};
+    std::atomic<bool> stop_{false};
+
+    // Текущее задание; пишется под mutex_ до публикации ticket_
+    const std::function<void(int, int)> *job_ = nullptr;
+    int begin_ = 0, end_ = 0;
+    SpinBarrier barrier_;
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <omp.h>
+
+#ifdef HAVE_TBB
+#include <execution>
+#include <tbb/global_control.h>
+#endif
+
+#include "thread_pool.h"
+
+// Одно и то же умножение матрицы на вектор через три бэкенда: OpenMP (как в
+// main.cpp), постоянный пул std::thread из common/thread_pool.h и параллельные
+// алгоритмы C++17 (std::execution::par_unseq поверх TBB). Ядро одно - row_dot,
+// входные данные одни: a[i][j] = i + j, b[j] = j. Все частичные суммы - целые
+// меньше 2^53, поэтому при любом порядке сложения результат точный и
+// сверяется с формулой c[i] = i * S1 + S2 на равенство.
+
+enum Backend { BACKEND_OMP, BACKEND_THREADS, BACKEND_PSTL };
+const char *backend_names[] = {"openmp", "std-thread", "pstl-par-unseq"};
+
+double row_dot(const double *a, const double *b, int n)
+{
+    double sum = 0.0;
+    for (int j = 0; j < n; ++j)
+        sum += a[j] * b[j];
+    return sum;
+}
+
+// Сверка с точным ответом; сам подсчёт - через transform_reduce
+bool verify(const double *c, int m, int n)
+{
+    double s1 = (double)n * (n - 1) / 2;
+    double s2 = (double)(n - 1) * n * (2.0 * n - 1) / 6;
+    std::vector<int> rows(m);
+    std::iota(rows.begin(), rows.end(), 0);
+    long long bad = std::transform_reduce(
+#ifdef HAVE_TBB
+        std::execution::par_unseq,
+#endif
+        rows.begin(), rows.end(), 0LL, std::plus<long long>(),
+        [&](int i) { return (c[i] != i * s1 + s2) ? 1LL : 0LL; });
+    return bad == 0;
+}
+
+void run_backend(Backend backend, ThreadPool &pool, const double *a, const double *b, double *c, int m, int n,
+                 int num_threads, double *time)
+{
+    memset(c, 0, sizeof(*c) * m);
+
+    if (backend == BACKEND_OMP)
+    {
+        omp_set_num_threads(num_threads);
+        *time = omp_get_wtime();
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < m; ++i)
+            c[i] = row_dot(a + (size_t)i * n, b, n);
+        *time = omp_get_wtime() - *time;
+    }
+    else if (backend == BACKEND_THREADS)
+    {
+        *time = omp_get_wtime();
+        pool.parallel_for(num_threads, 0, m, [&](int start_idx, int end_idx) {
+            for (int i = start_idx; i < end_idx; ++i)
+                c[i] = row_dot(a + (size_t)i * n, b, n);
+        });
+        *time = omp_get_wtime() - *time;
+    }
+    else
+    {
+        std::vector<int> rows(m);
+        std::iota(rows.begin(), rows.end(), 0);
+#ifdef HAVE_TBB
+        // Число потоков TBB ограничивается на время прогона
+        tbb::global_control limit(tbb::global_control::max_allowed_parallelism, num_threads);
+        *time = omp_get_wtime();
+        std::transform(std::execution::par_unseq, rows.begin(), rows.end(), c,
+                       [&](int i) { return row_dot(a + (size_t)i * n, b, n); });
+#else
+        *time = omp_get_wtime();
+        std::transform(rows.begin(), rows.end(), c,
+                       [&](int i) { return row_dot(a + (size_t)i * n, b, n); });
+#endif
+        *time = omp_get_wtime() - *time;
+    }
+}
+
+int main()
+{
+    int thread_counts[8] = {1, 2, 4, 7, 8, 16, 20, 40};
+    int sizes[2] = {20000, 40000};
+    const int repeats = 3; // Берётся лучшее из трёх, чтобы сравнивать накладные расходы, а не шум
+    const char *filename = "results_backends.csv";
+
+#ifndef HAVE_TBB
+    printf("Built without TBB: %s runs serially\n", backend_names[BACKEND_PSTL]);
+#endif
+
+    FILE *file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error opening file for writing\n");
+        exit(1);
+    }
+    fprintf(file, "N=M,Backend,Threads,Time,Speedup,Verified\n");
+
+    ThreadPool pool(40);
+    bool all_ok = true;
+
+    for (int test = 0; test < 2; ++test)
+    {
+        int m = sizes[test], n = m;
+
+        double *a = (double *)malloc(sizeof(*a) * m * n);
+        double *b = (double *)malloc(sizeof(*b) * n);
+        double *c = (double *)malloc(sizeof(*c) * m);
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < m; ++i)
+            for (int j = 0; j < n; ++j)
+                a[(size_t)i * n + j] = i + j;
+        for (int j = 0; j < n; ++j)
+            b[j] = j;
+
+        // Базовое время - обычный последовательный цикл с тем же ядром
+        double time_serial = omp_get_wtime();
+        for (int i = 0; i < m; ++i)
+            c[i] = row_dot(a + (size_t)i * n, b, n);
+        time_serial = omp_get_wtime() - time_serial;
+        if (!verify(c, m, n))
+        {
+            fprintf(stderr, "Serial result is wrong for n = %d\n", n);
+            exit(1);
+        }
+
+        for (int bk = 0; bk < 3; ++bk)
+        {
+            for (int t = 0; t < 8; ++t)
+            {
+                double best = 0.0, time;
+                bool ok = true;
+                for (int r = 0; r < repeats; ++r)
+                {
+                    run_backend((Backend)bk, pool, a, b, c, m, n, thread_counts[t], &time);
+                    ok = ok && verify(c, m, n);
+                    best = (r == 0) ? time : std::min(best, time);
+                }
+                all_ok = all_ok && ok;
+                printf("%s, n = %d, %d threads: %.6f s%s\n", backend_names[bk], n, thread_counts[t], best,
+                       ok ? "" : " WRONG RESULT");
+                fprintf(file, "%d,%s,%d,%.6f,%.2f,%d\n", n, backend_names[bk], thread_counts[t], best,
+                        time_serial / best, ok ? 1 : 0);
+            }
+        }
+
+        free(a);
+        free(b);
+        free(c);
+    }
+
+    fclose(file);
+    printf("Results written to %s\n", filename);
+
+    return all_ok ? 0 : 1;
+}
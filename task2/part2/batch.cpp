@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h> // Для exp, sqrt, erf, fabs
+#include <omp.h>  // Для OpenMP
+
+
+const double PI = 3.14159265358979323846;
+const int njobs = 10000;
+const int nsteps = 4000;
+const int chunk_steps = 1000; // Столько шагов один поток берёт из задания за раз
+
+struct IntegralJob
+{
+    double a, b;  // Пределы интегрирования
+    double param; // Параметр подынтегральной функции
+    int n;        // Число шагов
+    double result;
+};
+
+double func(double x, double p)
+{
+    return exp(-p * x * x);
+}
+
+double exact(double a, double b, double p)
+{
+    double s = sqrt(p);
+    return 0.5 * sqrt(PI / p) * (erf(b * s) - erf(a * s));
+}
+
+double integrate_omp(double (*func)(double, double), double a, double b, double p, int n)
+{
+    double h = (b - a) / n;
+    double sum = 0.0;
+
+    #pragma omp parallel
+    {
+        double sumloc = 0.0;
+
+        #pragma omp for
+        for (int i = 0; i < n; i++)
+            sumloc += func(a + h * (i + 0.5), p);
+
+        #pragma omp atomic
+        sum += sumloc;
+    }
+    sum *= h;
+    return sum;
+}
+
+// Все задания считаются одной командой потоков: каждое режется на куски по
+// chunk_steps шагов, и общий список кусков раздаётся динамически. Так потоки
+// распределяются и между заданиями, и внутри крупных заданий.
+void integrate_batch_omp(double (*func)(double, double), IntegralJob *jobs, int count)
+{
+    int *first_chunk = (int *)malloc(sizeof(*first_chunk) * (count + 1));
+    int *chunk_job = NULL;
+    double *partial = NULL;
+
+    first_chunk[0] = 0;
+    for (int j = 0; j < count; j++)
+        first_chunk[j + 1] = first_chunk[j] + (jobs[j].n + chunk_steps - 1) / chunk_steps;
+
+    int nchunks = first_chunk[count];
+    chunk_job = (int *)malloc(sizeof(*chunk_job) * nchunks);
+    partial = (double *)malloc(sizeof(*partial) * nchunks);
+
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(static)
+        for (int j = 0; j < count; j++)
+            for (int c = first_chunk[j]; c < first_chunk[j + 1]; c++)
+                chunk_job[c] = j;
+
+        #pragma omp for schedule(dynamic, 4)
+        for (int c = 0; c < nchunks; c++)
+        {
+            const IntegralJob *job = &jobs[chunk_job[c]];
+            double h = (job->b - job->a) / job->n;
+            int lo = (c - first_chunk[chunk_job[c]]) * chunk_steps;
+            int hi = lo + chunk_steps < job->n ? lo + chunk_steps : job->n;
+            double sumloc = 0.0;
+
+            for (int i = lo; i < hi; i++)
+                sumloc += func(job->a + h * (i + 0.5), job->param);
+            partial[c] = sumloc;
+        }
+
+        // Куски каждого задания складываются в фиксированном порядке
+        #pragma omp for schedule(static)
+        for (int j = 0; j < count; j++)
+        {
+            double sum = 0.0;
+            for (int c = first_chunk[j]; c < first_chunk[j + 1]; c++)
+                sum += partial[c];
+            jobs[j].result = sum * (jobs[j].b - jobs[j].a) / jobs[j].n;
+        }
+    }
+
+    free(first_chunk);
+    free(chunk_job);
+    free(partial);
+}
+
+void init_jobs(IntegralJob *jobs, int count)
+{
+    srand(42);
+    for (int j = 0; j < count; j++)
+    {
+        jobs[j].a = -4.0 * rand() / RAND_MAX;
+        jobs[j].b = 4.0 * rand() / RAND_MAX;
+        jobs[j].param = 0.1 + 4.9 * rand() / RAND_MAX;
+        // Задания разного размера, чтобы нагрузка была неравномерной
+        jobs[j].n = nsteps / 4 + rand() % (2 * nsteps);
+        jobs[j].result = 0.0;
+    }
+}
+
+double max_error(const IntegralJob *jobs, int count)
+{
+    double err = 0.0;
+    for (int j = 0; j < count; j++)
+    {
+        double e = fabs(jobs[j].result - exact(jobs[j].a, jobs[j].b, jobs[j].param));
+        if (e > err)
+            err = e;
+    }
+    return err;
+}
+
+void run_loop(IntegralJob *jobs, int num_threads, double *time)
+{
+    omp_set_num_threads(num_threads);
+
+    *time = omp_get_wtime();
+    for (int j = 0; j < njobs; j++)
+        jobs[j].result = integrate_omp(func, jobs[j].a, jobs[j].b, jobs[j].param, jobs[j].n);
+    *time = omp_get_wtime() - *time;
+    printf("Loop of integrate_omp (%d threads): %.6f s, %.0f integrals/s, max error %.3e\n",
+           num_threads, *time, njobs / *time, max_error(jobs, njobs));
+}
+
+void run_batch(IntegralJob *jobs, int num_threads, double *time)
+{
+    omp_set_num_threads(num_threads);
+
+    *time = omp_get_wtime();
+    integrate_batch_omp(func, jobs, njobs);
+    *time = omp_get_wtime() - *time;
+    printf("Batch (%d threads): %.6f s, %.0f integrals/s, max error %.3e\n",
+           num_threads, *time, njobs / *time, max_error(jobs, njobs));
+}
+
+int main()
+{
+    double time_loop, time_batch, time_serial;
+    int threads[] = {1, 2, 4, 7, 8, 16, 20, 40};
+
+    IntegralJob *jobs = (IntegralJob *)malloc(sizeof(*jobs) * njobs);
+    init_jobs(jobs, njobs);
+
+    run_batch(jobs, 1, &time_serial);
+
+    FILE *file = fopen("results_batch.csv", "w");
+    if (!file)
+    {
+        perror("Error opening file");
+        free(jobs);
+        return 1;
+    }
+
+    fprintf(file, "Threads,TimeLoop,TimeBatch,LoopIntegralsPerSec,BatchIntegralsPerSec,Speedup\n");
+
+    for (int i = 0; i < 8; i++)
+    {
+        run_loop(jobs, threads[i], &time_loop);
+        run_batch(jobs, threads[i], &time_batch);
+        fprintf(file, "%d,%.6f,%.6f,%.0f,%.0f,%.2f\n", threads[i], time_loop, time_batch,
+                njobs / time_loop, njobs / time_batch, time_serial / time_batch);
+    }
+
+    fclose(file);
+    free(jobs);
+    printf("Results saved to results_batch.csv\n");
+
+    return 0;
+}
@@ -3,6 +3,8 @@
 #include <math.h> // Для exp, sqrt, fabs
 #include <omp.h>  // Для OpenMP
 
+#include "expr.h" // Подынтегральная функция из командной строки
+
 
 const double PI = 3.14159265358979323846;
 const double a = -4.0;
@@ -45,6 +47,199 @@ double integrate_omp(double (*func)(double), double a, double b, int n)
     return sum;
 }
 
+// То же, что integrate_omp, но функция задана байткодом и считается пачками точек
+double integrate_omp_expr(const ExprProgram *prog, double a, double b, int n)
+{
+    double h = (b - a) / n;
+    double sum = 0.0;
+    int nbatches = (n + EXPR_BATCH - 1) / EXPR_BATCH;
+
+    #pragma omp parallel
+    {
+        double sumloc = 0.0;
+        double *regs = (double *)malloc(sizeof(*regs) * (prog->nregs + 2) * EXPR_BATCH);
+        double *x = regs + prog->nregs * EXPR_BATCH;
+        double *fx = x + EXPR_BATCH;
+
+        #pragma omp for
+        for (int bt = 0; bt < nbatches; bt++)
+        {
+            int first = bt * EXPR_BATCH;
+            int count = (n - first < EXPR_BATCH) ? n - first : EXPR_BATCH;
+
+            for (int i = 0; i < count; i++)
+                x[i] = a + h * (first + i + 0.5);
+            expr_eval(prog, x, count, regs, fx);
+            for (int i = 0; i < count; i++)
+                sumloc += fx[i];
+        }
+
+        free(regs);
+
+        #pragma omp atomic
+        sum += sumloc;
+    }
+    sum *= h;
+    return sum;
+}
+
+// Число блоков не зависит от числа потоков, поэтому порядок сложения,
+// а значит и результат, одинаков при любом размере команды.
+const int det_blocks = 1024;
+
+struct alignas(64) PartialSum // Каждый слот на своей кэш-линии
+{
+    double sum;
+    double comp;
+};
+
+// Детерминированный вариант integrate_omp: частичные суммы блоков лежат в
+// выровненных слотах и складываются попарным деревом в фиксированном порядке.
+// compensated != 0 включает суммирование Кэхэна внутри блока; n 64-битное.
+double integrate_omp_det(double (*func)(double), double a, double b, long long n, int compensated)
+{
+    double h = (b - a) / n;
+    PartialSum *slots = new PartialSum[det_blocks];
+
+    #pragma omp parallel for schedule(static)
+    for (int blk = 0; blk < det_blocks; blk++)
+    {
+        long long lo = n * blk / det_blocks;
+        long long hi = n * (blk + 1) / det_blocks;
+        double sum = 0.0, comp = 0.0;
+
+        if (compensated)
+        {
+            for (long long i = lo; i < hi; i++)
+            {
+                double y = func(a + h * (i + 0.5)) - comp;
+                double t = sum + y;
+                comp = (t - sum) - y;
+                sum = t;
+            }
+        }
+        else
+        {
+            for (long long i = lo; i < hi; i++)
+                sum += func(a + h * (i + 0.5));
+        }
+        slots[blk].sum = sum;
+        slots[blk].comp = comp;
+    }
+
+    // Пары (sum, comp) сливаются с точной ошибкой сложения (TwoSum): иначе
+    // округление при сложении сумм блоков теряется, и от компенсации внутри
+    // блоков остаётся только часть
+    for (int stride = 1; stride < det_blocks; stride *= 2)
+        for (int blk = 0; blk + stride < det_blocks; blk += 2 * stride)
+        {
+            double s1 = slots[blk].sum, s2 = slots[blk + stride].sum;
+            double s = s1 + s2;
+            if (compensated)
+            {
+                double bp = s - s1;
+                double err = (s1 - (s - bp)) + (s2 - bp);
+                slots[blk].comp += slots[blk + stride].comp - err;
+            }
+            slots[blk].sum = s;
+        }
+
+    double sum = (slots[0].sum - slots[0].comp) * h;
+    delete[] slots;
+    return sum;
+}
+
+// Узлы и веса двойной экспоненциальной замены x = phi(t), dx = w(t) dt.
+// [a, b] - tanh-sinh, [a, inf) и (-inf, b] - exp-sinh, (-inf, inf) - sinh-sinh.
+// Возвращает 0, если узел вырождается (упирается в конец отрезка или переполняется).
+static int de_node(double a, double b, double t, double *x, double *w)
+{
+    double u = 0.5 * PI * sinh(t);
+    double du = 0.5 * PI * cosh(t);
+
+    if (isinf(a) && isinf(b)) {
+        *x = sinh(u);
+        *w = du * cosh(u);
+    } else if (isinf(b)) {
+        double e = exp(u);
+        *x = a + e;
+        *w = du * e;
+    } else if (isinf(a)) {
+        double e = exp(u);
+        *x = b - e;
+        *w = du * e;
+    } else {
+        // расстояние до ближайшего конца считаем без вычитания 1 - tanh(u)
+        double half = 0.5 * (b - a);
+        double e = exp(-2.0 * fabs(u));
+        double delta = half * 2.0 * e / (1.0 + e);
+        *x = (u < 0.0) ? a + delta : b - delta;
+        *w = half * du * 4.0 * e / ((1.0 + e) * (1.0 + e));
+        if (*x <= a || *x >= b)
+            return 0;
+    }
+    return isfinite(*x) && isfinite(*w) && *w > 0.0;
+}
+
+// Сумма по узлам t = t0 + k * step, k = 0..count-1; уровни распараллелены по узлам.
+static double de_level_sum(double (*func)(double), double a, double b,
+                           double t0, double step, int count)
+{
+    double sum = 0.0;
+
+    #pragma omp parallel for reduction(+:sum)
+    for (int k = 0; k < count; k++) {
+        double x, w;
+        if (!de_node(a, b, t0 + step * k, &x, &w))
+            continue;
+        double term = w * func(x);
+        if (isfinite(term))
+            sum += term;
+    }
+    return sum;
+}
+
+// Квадратура tanh-sinh / exp-sinh / sinh-sinh; a и b могут быть +-INFINITY.
+// Каждый уровень вдвое уменьшает шаг и добавляет только нечётные узлы.
+// В *err пишется оценка погрешности |I_k - I_{k-1}|, в *nevals - число вызовов func.
+double integrate_tanh_sinh(double (*func)(double), double a, double b, double *err, int *nevals)
+{
+    const double tmax = 4.0;
+    const double tol = 1e-15;
+    const int max_levels = 10;
+
+    if (a == b) {
+        *err = 0.0;
+        *nevals = 0;
+        return 0.0;
+    }
+    if (a > b) {
+        double res = integrate_tanh_sinh(func, b, a, err, nevals);
+        return -res;
+    }
+
+    double h = 1.0;
+    int count = 2 * (int)tmax + 1;
+    double sum = de_level_sum(func, a, b, -tmax, h, count);
+    double res = h * sum;
+    *nevals = count;
+    *err = fabs(res);
+
+    for (int level = 1; level <= max_levels; level++) {
+        h *= 0.5;
+        count = (int)(tmax / h);
+        sum += de_level_sum(func, a, b, -tmax + h, 2.0 * h, count);
+        *nevals += count;
+
+        double res_new = h * sum;
+        *err = fabs(res_new - res);
+        res = res_new;
+        if (level > 2 && *err <= tol * fabs(res))
+            break;
+    }
+    return res;
+}
+
 
 void run_serial(double *time)
 {
@@ -65,13 +260,62 @@ void run_parallel(int num_threads, double *time)
     printf("Result (parallel, %d threads): %.12f; error %.12f\n", num_threads, res, fabs(res - sqrt(PI)));
 }
 
-int main()
+void run_parallel_det(int num_threads, int compensated, double *res, double *time)
+{
+    omp_set_num_threads(num_threads);
+
+    *time = omp_get_wtime();
+    *res = integrate_omp_det(func, a, b, nsteps, compensated);
+    *time = omp_get_wtime() - *time;
+    printf("Result (deterministic%s, %d threads): %.17f; error %.12f\n",
+           compensated ? ", Kahan" : "", num_threads, *res, fabs(*res - sqrt(PI)));
+}
+
+void run_parallel_expr(const ExprProgram *prog, const char *text, int num_threads, double *time)
+{
+    omp_set_num_threads(num_threads);
+
+    *time = omp_get_wtime();
+    double res = integrate_omp_expr(prog, a, b, nsteps);
+    *time = omp_get_wtime() - *time;
+    printf("Result (%s, %d threads): %.12f\n", text, num_threads, res);
+}
+
+void run_tanh_sinh(double *time)
+{
+    double err;
+    int nevals;
+
+    *time = omp_get_wtime();
+    double res = integrate_tanh_sinh(func, -INFINITY, INFINITY, &err, &nevals);
+    *time = omp_get_wtime() - *time;
+    printf("Result (tanh-sinh, %d evals): %.16f; error %.3e; estimated error %.3e; time %.6f\n",
+           nevals, res, fabs(res - sqrt(PI)), err, *time);
+}
+
+int main(int argc, char **argv)
 {
-    double time_serial, time_parallel;
+    // По умолчанию то же, что func, чтобы сравнить байткод с компилированным кодом
+    const char *expr_text = (argc > 1) ? argv[1] : "exp(-x*x)";
+    const char *expr_error;
+    ExprProgram prog;
+    if (!expr_compile(expr_text, &prog, &expr_error))
+    {
+        fprintf(stderr, "Bad integrand \"%s\": %s\n", expr_text, expr_error);
+        return 1;
+    }
+
+    double time_serial, time_parallel, time_det, time_kahan;
+    double time_compiled[8], time_expr, time_expr_serial = 0.0;
+    double res_det, res_kahan, ref_det = 0.0, ref_kahan = 0.0;
+    int reproducible = 1;
     int threads[] = {1, 2, 4, 7, 8, 16, 20, 40};
 
     run_serial(&time_serial);
 
+    double time_de;
+    run_tanh_sinh(&time_de);
+
     FILE *file = fopen("results.csv", "w");
     if (!file)
     {
@@ -79,16 +323,53 @@ int main()
         return 1;
     }
 
-    fprintf(file, "Threads,Time,Speedup\n");
+    fprintf(file, "Threads,Time,Speedup,TimeDet,SpeedupDet,TimeKahan,SpeedupKahan\n");
 
     for (int i = 0; i < 8; i++)
     {
         run_parallel(threads[i], &time_parallel);
-        fprintf(file, "%d,%.6f,%.2f\n", threads[i], time_parallel, time_serial/time_parallel);
+        time_compiled[i] = time_parallel;
+        run_parallel_det(threads[i], 0, &res_det, &time_det);
+        run_parallel_det(threads[i], 1, &res_kahan, &time_kahan);
+        if (i == 0)
+        {
+            ref_det = res_det;
+            ref_kahan = res_kahan;
+        }
+        else if (res_det != ref_det || res_kahan != ref_kahan)
+        {
+            reproducible = 0;
+        }
+        fprintf(file, "%d,%.6f,%.2f,%.6f,%.2f,%.6f,%.2f\n", threads[i],
+                time_parallel, time_serial/time_parallel,
+                time_det, time_serial/time_det, time_kahan, time_serial/time_kahan);
     }
 
     fclose(file);
+    printf("Deterministic results are %s across thread counts\n",
+           reproducible ? "bitwise identical" : "DIFFERENT");
     printf("Results saved to results.csv\n");
 
+    file = fopen("results_expr.csv", "w");
+    if (!file)
+    {
+        perror("Error opening file");
+        return 1;
+    }
+
+    fprintf(file, "Threads,Time,Speedup,TimeCompiled,SlowdownVsCompiled\n");
+
+    for (int i = 0; i < 8; i++)
+    {
+        run_parallel_expr(&prog, expr_text, threads[i], &time_expr);
+        if (i == 0)
+            time_expr_serial = time_expr;
+        fprintf(file, "%d,%.6f,%.2f,%.6f,%.2f\n", threads[i], time_expr, time_expr_serial / time_expr,
+                time_compiled[i], time_expr / time_compiled[i]);
+    }
+
+    fclose(file);
+    printf("Results saved to results_expr.csv\n");
+
     return 0;
 }
@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h> // Для fabs, sqrt
+#include <omp.h>  // Для OpenMP
+
+
+const int max_dim = 10;
+const int log2_points = 20;             // 2^20 точек на одну реплику
+const int npoints = 1 << log2_points;
+const int nreplicates = 8;              // Независимо рандомизированные реплики для оценки ошибки
+const int batch = 256;                  // Столько точек подаётся в функцию за один вызов
+const uint64_t seed = 20240501;
+
+enum Method { MC_PHILOX, QMC_SOBOL, QMC_HALTON };
+const char *method_names[] = {"mc-philox", "qmc-sobol", "qmc-halton"};
+
+// G-функция Соболя: интеграл по единичному кубу равен 1 при любой размерности.
+// Вычисляет значения сразу для count точек, лежащих подряд по dim координат.
+void func(const double *x, int dim, int count, double *out)
+{
+    for (int p = 0; p < count; p++)
+    {
+        const double *xp = x + (size_t)p * dim;
+        double prod = 1.0;
+        for (int d = 0; d < dim; d++)
+            prod *= (fabs(4.0 * xp[d] - 2.0) + d) / (1.0 + d);
+        out[p] = prod;
+    }
+}
+
+uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Philox4x32-10: счётчик (номер точки, блок координат, реплика) -> 4 случайных слова.
+// Поток определяется только счётчиком, поэтому результат не зависит от числа потоков.
+void philox4x32(uint32_t ctr[4], uint32_t key0, uint32_t key1)
+{
+    for (int round = 0; round < 10; round++)
+    {
+        uint64_t p0 = (uint64_t)0xD2511F53u * ctr[0];
+        uint64_t p1 = (uint64_t)0xCD9E8D57u * ctr[2];
+        uint32_t c0 = (uint32_t)(p1 >> 32) ^ ctr[1] ^ key0;
+        uint32_t c2 = (uint32_t)(p0 >> 32) ^ ctr[3] ^ key1;
+        ctr[1] = (uint32_t)p1;
+        ctr[3] = (uint32_t)p0;
+        ctr[0] = c0;
+        ctr[2] = c2;
+        key0 += 0x9E3779B9u;
+        key1 += 0xBB67AE85u;
+    }
+}
+
+// Начальные направляющие числа Соболя (Joe, Kuo) для измерений 2..10;
+// первое измерение - последовательность ван дер Корпута.
+const int sobol_s[max_dim] = {0, 1, 2, 3, 3, 4, 4, 5, 5, 5};
+const int sobol_a[max_dim] = {0, 0, 1, 1, 2, 1, 4, 2, 4, 7};
+const int sobol_m[max_dim][5] = {
+    {0}, {1}, {1, 3}, {1, 3, 1}, {1, 1, 1},
+    {1, 1, 3, 3}, {1, 3, 5, 13}, {1, 1, 5, 5, 17}, {1, 1, 5, 5, 5}, {1, 1, 7, 11, 19}};
+
+uint32_t sobol_v[max_dim][32];
+
+void init_sobol()
+{
+    for (int k = 0; k < 32; k++)
+        sobol_v[0][k] = 1u << (31 - k);
+
+    for (int d = 1; d < max_dim; d++)
+    {
+        int s = sobol_s[d];
+        for (int k = 0; k < s; k++)
+            sobol_v[d][k] = (uint32_t)sobol_m[d][k] << (31 - k);
+        for (int k = s; k < 32; k++)
+        {
+            uint32_t v = sobol_v[d][k - s] ^ (sobol_v[d][k - s] >> s);
+            for (int j = 1; j < s; j++)
+                if ((sobol_a[d] >> (s - 1 - j)) & 1)
+                    v ^= sobol_v[d][k - j];
+            sobol_v[d][k] = v;
+        }
+    }
+}
+
+const int halton_base[max_dim] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29};
+const int halton_digits = 53; // Для основания 2 этого хватает на всю мантиссу double
+
+// Рандомизация одной реплики: цифровой сдвиг для Соболя и случайные
+// перестановки цифр (по позиции и измерению) для Халтона.
+struct Scramble
+{
+    uint32_t shift[max_dim];
+    unsigned char perm[max_dim][halton_digits][32];
+};
+
+void init_scramble(Scramble *sc, int replicate)
+{
+    uint64_t state = seed + 0x1000u * (uint64_t)replicate;
+
+    for (int d = 0; d < max_dim; d++)
+    {
+        sc->shift[d] = (uint32_t)splitmix64(&state);
+        int base = halton_base[d];
+        for (int k = 0; k < halton_digits; k++)
+        {
+            unsigned char *perm = sc->perm[d][k];
+            for (int j = 0; j < base; j++)
+                perm[j] = (unsigned char)j;
+            for (int j = base - 1; j > 0; j--)
+            {
+                int r = (int)(splitmix64(&state) % (uint64_t)(j + 1));
+                unsigned char t = perm[j];
+                perm[j] = perm[r];
+                perm[r] = t;
+            }
+        }
+    }
+}
+
+void point(Method method, const Scramble *sc, uint32_t replicate, uint32_t idx, int dim, double *x)
+{
+    if (method == QMC_SOBOL)
+    {
+        for (int d = 0; d < dim; d++)
+        {
+            uint32_t v = sc->shift[d];
+            for (int k = 0; idx >> k; k++)
+                if ((idx >> k) & 1)
+                    v ^= sobol_v[d][k];
+            x[d] = (v + 0.5) * (1.0 / 4294967296.0);
+        }
+    }
+    else if (method == QMC_HALTON)
+    {
+        for (int d = 0; d < dim; d++)
+        {
+            int base = halton_base[d];
+            double inv = 1.0 / base, f = inv, sum = 0.0;
+            uint32_t i = idx;
+            for (int k = 0; k < halton_digits && f > 1e-17; k++)
+            {
+                sum += sc->perm[d][k][i % base] * f;
+                i /= base;
+                f *= inv;
+            }
+            x[d] = sum;
+        }
+    }
+    else
+    {
+        for (int d = 0; d < dim; d += 4)
+        {
+            uint32_t ctr[4] = {idx, (uint32_t)d, replicate, 0};
+            philox4x32(ctr, (uint32_t)seed, (uint32_t)(seed >> 32));
+            for (int j = 0; j < 4 && d + j < dim; j++)
+                x[d + j] = (ctr[j] + 0.5) * (1.0 / 4294967296.0);
+        }
+    }
+}
+
+// Среднее по npoints точкам для каждой из nreplicates реплик; итог - среднее
+// реплик, а оценка ошибки - их стандартное отклонение, делённое на sqrt(R).
+double integrate_qmc_omp(void (*func)(const double *, int, int, double *), Method method, int dim,
+                         const Scramble *scrambles, double *std_error)
+{
+    double means[nreplicates];
+    int nbatches = npoints / batch;
+    // Сумма каждой пачки пишется в свой элемент и складывается в одном и том же
+    // порядке, поэтому результат не зависит от числа потоков
+    double *partial = (double *)malloc(sizeof(*partial) * nbatches);
+
+    for (int r = 0; r < nreplicates; r++)
+    {
+        #pragma omp parallel
+        {
+            double *x = (double *)malloc(sizeof(*x) * batch * dim);
+            double *fx = (double *)malloc(sizeof(*fx) * batch);
+
+            #pragma omp for schedule(static)
+            for (int bt = 0; bt < nbatches; bt++)
+            {
+                for (int p = 0; p < batch; p++)
+                    point(method, &scrambles[r], r, (uint32_t)(bt * batch + p), dim, x + p * dim);
+                func(x, dim, batch, fx);
+                double sum = 0.0;
+                for (int p = 0; p < batch; p++)
+                    sum += fx[p];
+                partial[bt] = sum;
+            }
+
+            free(x);
+            free(fx);
+        }
+
+        double sum = 0.0;
+        for (int bt = 0; bt < nbatches; bt++)
+            sum += partial[bt];
+        means[r] = sum / npoints;
+    }
+    free(partial);
+
+    double mean = 0.0, var = 0.0;
+    for (int r = 0; r < nreplicates; r++)
+        mean += means[r];
+    mean /= nreplicates;
+    for (int r = 0; r < nreplicates; r++)
+        var += (means[r] - mean) * (means[r] - mean);
+    var /= nreplicates - 1;
+    *std_error = sqrt(var / nreplicates);
+    return mean;
+}
+
+void run_parallel(Method method, int dim, int num_threads, const Scramble *scrambles,
+                  double *res, double *std_error, double *time)
+{
+    omp_set_num_threads(num_threads);
+    printf("Running %s, dim %d with %d threads...\n", method_names[method], dim, num_threads);
+
+    *time = omp_get_wtime();
+    *res = integrate_qmc_omp(func, method, dim, scrambles, std_error);
+    *time = omp_get_wtime() - *time;
+    printf("Result (%s, dim %d, %d threads): %.12f; error %.3e; estimated error %.3e\n",
+           method_names[method], dim, num_threads, *res, fabs(*res - 1.0), *std_error);
+}
+
+int main()
+{
+    double time_serial, time_parallel, res, std_error;
+    int threads[] = {1, 2, 4, 7, 8, 16, 20, 40};
+    int dims[] = {4, 10};
+
+    init_sobol();
+    Scramble *scrambles = (Scramble *)malloc(sizeof(*scrambles) * nreplicates);
+    for (int r = 0; r < nreplicates; r++)
+        init_scramble(&scrambles[r], r);
+
+    FILE *file = fopen("results_qmc.csv", "w");
+    if (!file)
+    {
+        perror("Error opening file");
+        free(scrambles);
+        return 1;
+    }
+
+    fprintf(file, "Method,Dim,Threads,Time,Speedup,Result,Error,EstimatedError\n");
+
+    for (int m = 0; m < 3; m++)
+    {
+        for (int d = 0; d < 2; d++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                run_parallel((Method)m, dims[d], threads[i], scrambles, &res, &std_error, &time_parallel);
+                if (i == 0)
+                    time_serial = time_parallel;
+                fprintf(file, "%s,%d,%d,%.6f,%.2f,%.12f,%.3e,%.3e\n", method_names[m], dims[d], threads[i],
+                        time_parallel, time_serial / time_parallel, res, fabs(res - 1.0), std_error);
+            }
+        }
+    }
+
+    fclose(file);
+    free(scrambles);
+    printf("Results saved to results_qmc.csv\n");
+
+    return 0;
+}
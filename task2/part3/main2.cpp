@@ -4,55 +4,220 @@
 #include <omp.h>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
 
-void run_solve(std::vector<std::vector<double>> &A, std::vector<double> &b, std::vector<double> &x, int num_threads, double *time)
+#include "matrix.h"
+#include "spectrum.h"
+#include "precond.h"
+
+// JACOBI: x_new = x_old - t(Ax_old - b) в отдельный буфер, затем буферы меняются
+// местами; итерации и результат не зависят от числа потоков.
+// CHAOTIC: x обновляется на месте, пока другие потоки ещё читают его в той же
+// итерации (асинхронный вариант), число итераций зависит от расписания.
+enum SolveMode { MODE_JACOBI, MODE_CHAOTIC };
+
+// FIXED: прежний шаг t = 0.0001.
+// OPTIMAL: по оценке спектра [l, L] берётся оптимальный стационарный шаг 2 / (l + L).
+// CHEBYSHEV: тот же шаг плюс чебышёвское ускорение
+//   x_{k+1} = w_{k+1} (x_k - tau r_k) + (1 - w_{k+1}) x_{k-1};
+// нужен x_{k-1}, поэтому работает только в режиме JACOBI.
+enum StepMode { STEP_FIXED, STEP_OPTIMAL, STEP_CHEBYSHEV };
+const char *step_suffix[] = {"", "_optimal", "_chebyshev"};
+
+// Телеметрия одного решения: норма невязки каждой итерации попадает в
+// history, критерий останова проверяется только в точках проверки (см. run_solve).
+struct ResidualSample
+{
+    int iter;
+    double criterion;
+    double time;
+};
+
+struct SolveStats
+{
+    int iters = 0;
+    int checks = 0;
+    double rate = 0.0;        // Оценка сокращения невязки за итерацию
+    double time_reduce = 0.0; // Барьер и редукция нормы невязки плюс сложение res2 на проверках
+    std::vector<ResidualSample> history;
+};
+
+// С предобусловливателем M шаг делается по M^-1 (Ax - b): нужен весь вектор
+// невязки до шага, поэтому на итерацию два прохода (невязка, затем M^-1 и
+// обновление x) вместо одного, и только в режиме JACOBI. Оптимальный и
+// чебышёвский шаги считаются по спектру M^-1 A. Время включает setup(A).
+// Критерий проверяется раз в check_interval итераций; с adaptive интервал
+// дополнительно растягивается по экстраполяции скорости сходимости.
+template <typename Preconditioner>
+void run_solve(DenseMatrix &A, std::vector<double> &b, std::vector<double> &x, Preconditioner &M, SolveMode mode,
+               StepMode step, int check_interval, bool adaptive, int num_threads, double *time, SolveStats *stats)
 {
-    printf("Num threads: %d\n", num_threads);
+    printf("Num threads: %d, preconditioner: %s\n", num_threads, M.name());
+    bool preconditioned = strcmp(M.name(), "none") != 0;
     int n = b.size();
-    double t = 0.0001;
+    double tau = 0.0001;
+    double rho = 0.0, omega = 1.0;
     double eps = 0.000001;
     double criterion;
-    //int num_iters = 0;
-    double num = 0, denum = 0;
+    int num_iters = 0;
+    int next_check = 1, last_check = 0;
+    double last_criterion = 0.0;
+    bool check = true;
+    double num = 0, denum = 0, rr = 0;
+    double t_rows = 0.0, time_sync = 0.0;
+
+    std::vector<double> x_buf(x), x_buf2(x);
+    std::vector<double> res2(n);
+    std::vector<double> r(preconditioned ? n : 0), z(preconditioned ? n : 0);
+    double *x_old = x.data();
+    double *x_new = (mode == MODE_JACOBI) ? x_buf.data() : x.data();
+    double *x_prev = (mode == MODE_JACOBI) ? x_buf2.data() : x.data();
+
+    *stats = SolveStats();
 
     omp_set_num_threads(num_threads);
     *time = omp_get_wtime();
 
+    M.setup(A);
+
+    if (step != STEP_FIXED) {
+        double lmin, lmax;
+        if (preconditioned) {
+            PreconditionedOperator<Preconditioner> op(A, M);
+            estimate_spectrum(op, 20, &lmin, &lmax);
+        } else {
+            DenseOperator op(A);
+            estimate_spectrum(op, 20, &lmin, &lmax);
+        }
+        tau = 2.0 / (lmin + lmax);
+        rho = (lmax - lmin) / (lmax + lmin);
+        printf("Spectrum estimate: [%g, %g], tau = %g\n", lmin, lmax, tau);
+    }
+    bool chebyshev = (step == STEP_CHEBYSHEV && mode == MODE_JACOBI);
+
     #pragma omp parallel
     {
+        // b не меняется, поэтому его норма считается один раз
+        #pragma omp for reduction(+:denum)
+        for (int i = 0; i < n; i++) {
+            denum += b[i] * b[i];
+        }
+
+        // Одно умножение на итерацию: невязка r = Ax - b строки i сразу идёт и в
+        // норму, и в обновление x[i]. Норма rr для истории копится редукцией на
+        // каждой итерации; её порядок сложения зависит от потоков, поэтому
+        // критерий останова берётся из res2, которая пишется только на итерациях
+        // проверки (check). Поток 0 отмечает конец своих строк: время до общей
+        // суммы rr (ожидание на барьере и редукция) идёт в time_reduce.
         do {
-            #pragma omp for
-            for (int i = 0; i < n; i++) {
-                double sum = 0;
-                for (int j = 0; j < n; j++) {
-                    sum += A[i][j] * x[j];  
+            if (preconditioned) {
+                #pragma omp for nowait reduction(+:rr)
+                for (int i = 0; i < n; i++) {
+                    const double *Ai = A.row(i);
+                    double sum = 0;
+                    for (int j = 0; j < n; j++) {
+                        sum += Ai[j] * x_old[j];
+                    }
+                    r[i] = sum - b[i];
+                    rr += r[i] * r[i];
+                    if (check) {
+                        res2[i] = r[i] * r[i];
+                    }
                 }
-                x[i] -= t * (sum - b[i]);
-            }
+                #pragma omp master
+                t_rows = omp_get_wtime();
+                #pragma omp barrier
+                #pragma omp master
+                time_sync += omp_get_wtime() - t_rows;
+
+                M.apply(r.data(), z.data());
 
-            num = 0.0, denum = 0.0;
-            #pragma omp for reduction(+:num, denum)
-            for (int i = 0; i < n; i++) {
-                double sum = 0;
-                for (int j = 0; j < n; j++) {
-                    sum += A[i][j] * x[j];  
+                #pragma omp for
+                for (int i = 0; i < n; i++) {
+                    x_new[i] = omega * (x_old[i] - tau * z[i]) + (1.0 - omega) * x_prev[i];
                 }
-                num += (sum - b[i]) * (sum - b[i]);
-                denum += b[i] * b[i];
+            } else {
+                #pragma omp for nowait reduction(+:rr)
+                for (int i = 0; i < n; i++) {
+                    const double *Ai = A.row(i);
+                    double sum = 0;
+                    for (int j = 0; j < n; j++) {
+                        sum += Ai[j] * x_old[j];
+                    }
+                    double diff = sum - b[i];
+                    rr += diff * diff;
+                    if (check) {
+                        res2[i] = diff * diff;
+                    }
+                    x_new[i] = omega * (x_old[i] - tau * diff) + (1.0 - omega) * x_prev[i];
+                }
+                #pragma omp master
+                t_rows = omp_get_wtime();
+                #pragma omp barrier
+                #pragma omp master
+                time_sync += omp_get_wtime() - t_rows;
             }
-            
+
+            // Квадраты невязки складываются всегда в одном порядке, чтобы критерий
+            // не зависел от числа потоков; указатели сдвигаются здесь же
             #pragma omp single
             {
-                criterion = sqrt(num) / sqrt(denum);
-                //num_iters++;
+                num_iters++;
+                stats->history.push_back({num_iters, sqrt(rr) / sqrt(denum), omp_get_wtime() - *time});
+                rr = 0.0;
+                if (check) {
+                    double t0 = omp_get_wtime();
+                    num = 0.0;
+                    for (int i = 0; i < n; i++) {
+                        num += res2[i];
+                    }
+                    criterion = sqrt(num) / sqrt(denum);
+                    stats->time_reduce += omp_get_wtime() - t0;
+                    stats->checks++;
+
+                    // По двум последним проверкам невязка экстраполируется как геометрическая
+                    // прогрессия; с adaptive следующая проверка - через половину предсказанного остатка
+                    int interval = check_interval;
+                    if (last_check > 0 && criterion < last_criterion) {
+                        double log_rate = log(criterion / last_criterion) / (num_iters - last_check);
+                        stats->rate = exp(log_rate);
+                        if (adaptive && criterion > eps) {
+                            double remaining = log(eps / criterion) / log_rate;
+                            interval = std::max(interval, (int)(0.5 * remaining));
+                        }
+                    }
+                    last_check = num_iters;
+                    last_criterion = criterion;
+                    next_check = num_iters + interval;
+                }
+                check = (num_iters + 1 >= next_check);
+                if (chebyshev) {
+                    omega = (num_iters == 1) ? 1.0 / (1.0 - 0.5 * rho * rho) : 1.0 / (1.0 - 0.25 * rho * rho * omega);
+                }
+                double *x_tmp = x_prev;
+                x_prev = x_old;
+                x_old = x_new;
+                x_new = x_tmp;
             }
         } while (criterion > eps);
     }
 
+    if (x_old != x.data()) {
+        std::copy(x_old, x_old + n, x.begin());
+    }
+
     *time = omp_get_wtime() - *time;
+    stats->iters = num_iters;
+    stats->time_reduce += time_sync;
+    printf("Iterations: %d, residual checks: %d, rate %.6f, reduce time %.6f\n",
+           num_iters, stats->checks, stats->rate, stats->time_reduce);
 }
 
-void writeCSV(const char *filename, double results[15])
+// Кроме времён и ускорений для каждого числа потоков t пишутся число
+// итераций I<t>, время итерации TPI<t> и время в сборе невязки R<t>
+void writeCSV(const char *filename, const int sizes[], double results[][15], SolveStats stats[][8],
+              const int thread_counts[], int num_sizes)
 {
     FILE *file = fopen(filename, "w");
     if (file == NULL)
@@ -61,48 +226,162 @@ void writeCSV(const char *filename, double results[15])
         exit(1);
     }
 
-    fprintf(file, "T1, T2, S2, T4, S4, T7, S7, T8, S8, T16, S16, T20, S20, T40, S40\n");
-
-    for (int i = 0; i < 15; ++i) {
-        fprintf(file, "%.6f", results[i]);
-        if (i < 14) fprintf(file, ",");
+    fprintf(file, "N, T1, T2, S2, T4, S4, T7, S7, T8, S8, T16, S16, T20, S20, T40, S40");
+    for (int t = 0; t < 8; ++t) {
+        fprintf(file, ", I%d, TPI%d, R%d", thread_counts[t], thread_counts[t], thread_counts[t]);
     }
     fprintf(file, "\n");
 
+    for (int s = 0; s < num_sizes; ++s) {
+        fprintf(file, "%d", sizes[s]);
+        for (int i = 0; i < 15; ++i) {
+            fprintf(file, ",%.6f", results[s][i]);
+        }
+        for (int t = 0; t < 8; ++t) {
+            double time = (t == 0) ? results[s][0] : results[s][2 * t - 1];
+            fprintf(file, ",%d,%.3e,%.6f", stats[s][t].iters, time / stats[s][t].iters, stats[s][t].time_reduce);
+        }
+        fprintf(file, "\n");
+    }
+
     fclose(file);
 }
 
+// История невязки: строка на каждую итерацию каждого прогона
+void writeHistory(FILE *file, int n, int num_threads, const SolveStats &stats)
+{
+    for (size_t k = 0; k < stats.history.size(); ++k) {
+        const ResidualSample &h = stats.history[k];
+        fprintf(file, "%d,%d,%d,%.6e,%.6f\n", n, num_threads, h.iter, h.criterion, h.time);
+    }
+}
 
-int main()
+
+// Прогон всех размеров и чисел потоков с одним предобусловливателем;
+// пишет results_2[_chaotic][_<step>][_adaptive][_<precond>].csv и такую же историю
+template <typename Preconditioner>
+void run_sweep(Preconditioner &M, SolveMode mode, StepMode step, int check_interval, bool adaptive)
 {
-    int n = 1000;
+    char precond_suffix[32] = "";
+    if (strcmp(M.name(), "none") != 0)
+        snprintf(precond_suffix, sizeof(precond_suffix), "_%s", M.name());
+
+    // При n >= 20000 фиксированный шаг t = 0.0001 больше 2 / lambda_max = 2 / (n + 1), итерации расходятся
+    const int sizes[5] = {1000, 2000, 5000, 10000, 15000};
     double time_parallel, time_serial;
 
     int thread_counts[8] = {1, 2, 4, 7, 8, 16, 20, 40};
-    const char *filename = "results_2.csv";
-    double results[15] = {0};
+    char filename[64];
+    snprintf(filename, sizeof(filename), "results_2%s%s%s%s.csv", (mode == MODE_CHAOTIC) ? "_chaotic" : "",
+             step_suffix[step], adaptive ? "_adaptive" : "", precond_suffix);
+    double results[5][15] = {{0}};
+    static SolveStats stats[5][8];
 
-    std::vector<std::vector<double>> A(n, std::vector<double>(n, 1.0));
-    std::vector<double> b(n, n + 1);
-    std::vector<double> x(n, 0.0);
+    char history_name[64];
+    snprintf(history_name, sizeof(history_name), "history_2%s%s%s%s.csv", (mode == MODE_CHAOTIC) ? "_chaotic" : "",
+             step_suffix[step], adaptive ? "_adaptive" : "", precond_suffix);
+    FILE *history = fopen(history_name, "w");
+    if (history == NULL)
+    {
+        fprintf(stderr, "Error opening file for writing\n");
+        exit(1);
+    }
+    fprintf(history, "N, Threads, Iter, Criterion, Time\n");
 
-    for (int i = 0; i < n; ++i)
+    for (int s = 0; s < 5; ++s)
     {
-        A[i][i] = 2.0;
+        int n = sizes[s];
+        printf("n = %d\n", n);
+
+        DenseMatrix A(n, n, true);
+        std::vector<double> b(n, n + 1);
+        std::vector<double> x(n, 0.0);
+
+        // Первое касание из тех же потоков, что потом читают строки
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; ++i)
+        {
+            double *Ai = A.row(i);
+            for (int j = 0; j < n; ++j)
+                Ai[j] = 1.0;
+            Ai[i] = 2.0;
+        }
+
+        run_solve(A, b, x, M, mode, step, check_interval, adaptive, thread_counts[0], &time_serial, &stats[s][0]);
+        writeHistory(history, n, thread_counts[0], stats[s][0]);
+        results[s][0] = time_serial;
+
+        for (int i = 1; i < 8; ++i)
+        {
+            std::fill(x.begin(), x.end(), 0.0);
+            run_solve(A, b, x, M, mode, step, check_interval, adaptive, thread_counts[i], &time_parallel, &stats[s][i]);
+            writeHistory(history, n, thread_counts[i], stats[s][i]);
+            results[s][2 * i - 1] = time_parallel;
+            results[s][2 * i] = time_serial / time_parallel;
+        }
     }
 
-    run_solve(A, b, x, thread_counts[0], &time_serial);
-    results[0] = time_serial;
+    fclose(history);
+    writeCSV(filename, sizes, results, stats, thread_counts, 5);
+}
+
 
-    for (int i = 1; i < 8; ++i)
+int main(int argc, char **argv)
+{
+    SolveMode mode = MODE_JACOBI;
+    StepMode step = STEP_FIXED;
+    int check_interval = 1;
+    bool adaptive = false;
+    const char *precond = "none";
+    for (int k = 1; k < argc; ++k)
     {
-        std::fill(x.begin(), x.end(), 0.0);
-        run_solve(A, b, x, thread_counts[i], &time_parallel);
-        results[2 * i - 1] = time_parallel;
-        results[2 * i] = time_serial / time_parallel;
+        if (strcmp(argv[k], "chaotic") == 0)
+            mode = MODE_CHAOTIC;
+        else if (strcmp(argv[k], "optimal") == 0)
+            step = STEP_OPTIMAL;
+        else if (strcmp(argv[k], "chebyshev") == 0)
+            step = STEP_CHEBYSHEV;
+        else if (strncmp(argv[k], "check=", 6) == 0 && atoi(argv[k] + 6) > 0)
+            check_interval = atoi(argv[k] + 6);
+        else if (strcmp(argv[k], "adaptive") == 0)
+            adaptive = true;
+        else if (strcmp(argv[k], "precond=jacobi") == 0 || strcmp(argv[k], "precond=block_jacobi") == 0 ||
+                 strcmp(argv[k], "precond=block_ssor") == 0)
+            precond = argv[k] + 8;
+        else
+        {
+            fprintf(stderr, "Usage: %s [chaotic] [optimal|chebyshev] [check=N] [adaptive] [precond=jacobi|block_jacobi|block_ssor]\n", argv[0]);
+            return 1;
+        }
     }
 
-    writeCSV(filename, results);
+    // Предобусловленный шаг использует невязку всего вектора, асинхронный режим с ним не совместим
+    if (mode == MODE_CHAOTIC && strcmp(precond, "none") != 0)
+    {
+        fprintf(stderr, "Preconditioning needs the jacobi mode, not chaotic\n");
+        return 1;
+    }
+
+    if (strcmp(precond, "jacobi") == 0)
+    {
+        JacobiPreconditioner M;
+        run_sweep(M, mode, step, check_interval, adaptive);
+    }
+    else if (strcmp(precond, "block_jacobi") == 0)
+    {
+        BlockJacobiPreconditioner M;
+        run_sweep(M, mode, step, check_interval, adaptive);
+    }
+    else if (strcmp(precond, "block_ssor") == 0)
+    {
+        BlockSSORPreconditioner M;
+        run_sweep(M, mode, step, check_interval, adaptive);
+    }
+    else
+    {
+        IdentityPreconditioner M;
+        run_sweep(M, mode, step, check_interval, adaptive);
+    }
 
     return 0;
 }
@@ -0,0 +1,224 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <omp.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "matrix.h"
+#include "precond.h"
+
+// Метод сопряжённых градиентов с предобусловливателем M из precond.h для
+// симметричной положительно определённой A. Как и в main2, всё решение идёт
+// внутри одной параллельной области; скаляры (alpha, beta, нормы) считаются
+// в omp single, там же обнуляются суммы. Время включает setup(A).
+template <typename Preconditioner>
+void run_solve(DenseMatrix &A, std::vector<double> &b, std::vector<double> &x, Preconditioner &M,
+               int num_threads, double *time, int *iters)
+{
+    printf("Num threads: %d, preconditioner: %s\n", num_threads, M.name());
+    int n = b.size();
+    double eps = 0.000001;
+    double criterion;
+    int num_iters = 0;
+    double rr = 0.0, rr_new = 0.0, rz = 0.0, rz_new = 0.0, pAp = 0.0, denum = 0.0;
+    double alpha, beta;
+
+    std::vector<double> r(n), z(n), p(n), Ap(n);
+
+    omp_set_num_threads(num_threads);
+    *time = omp_get_wtime();
+
+    M.setup(A);
+
+    #pragma omp parallel
+    {
+        // r = b - Ax
+        #pragma omp for reduction(+:rr, denum)
+        for (int i = 0; i < n; i++) {
+            const double *Ai = A.row(i);
+            double sum = 0;
+            for (int j = 0; j < n; j++) {
+                sum += Ai[j] * x[j];
+            }
+            r[i] = b[i] - sum;
+            rr += r[i] * r[i];
+            denum += b[i] * b[i];
+        }
+
+        // z = M^-1 r, p = z
+        M.apply(r.data(), z.data());
+
+        #pragma omp for reduction(+:rz)
+        for (int i = 0; i < n; i++) {
+            p[i] = z[i];
+            rz += r[i] * z[i];
+        }
+
+        #pragma omp single
+        criterion = sqrt(rr) / sqrt(denum);
+
+        while (criterion > eps) {
+            #pragma omp for reduction(+:pAp)
+            for (int i = 0; i < n; i++) {
+                const double *Ai = A.row(i);
+                double sum = 0;
+                for (int j = 0; j < n; j++) {
+                    sum += Ai[j] * p[j];
+                }
+                Ap[i] = sum;
+                pAp += p[i] * sum;
+            }
+
+            #pragma omp single
+            {
+                alpha = rz / pAp;
+                pAp = 0.0;
+            }
+
+            #pragma omp for reduction(+:rr_new)
+            for (int i = 0; i < n; i++) {
+                x[i] += alpha * p[i];
+                r[i] -= alpha * Ap[i];
+                rr_new += r[i] * r[i];
+            }
+
+            M.apply(r.data(), z.data());
+
+            #pragma omp for reduction(+:rz_new)
+            for (int i = 0; i < n; i++) {
+                rz_new += r[i] * z[i];
+            }
+
+            #pragma omp single
+            {
+                beta = rz_new / rz;
+                rz = rz_new;
+                rz_new = 0.0;
+                rr = rr_new;
+                rr_new = 0.0;
+                criterion = sqrt(rr) / sqrt(denum);
+                num_iters++;
+            }
+
+            #pragma omp for
+            for (int i = 0; i < n; i++) {
+                p[i] = z[i] + beta * p[i];
+            }
+        }
+    }
+
+    *time = omp_get_wtime() - *time;
+    *iters = num_iters;
+    printf("Iterations: %d\n", num_iters);
+    // Неявные барьеры: три omp for и omp single до цикла, затем пять omp for и два single на итерацию
+    long barriers = 4 + 7L * num_iters;
+    printf("Barriers per iteration: %.2f (%ld total)\n",
+           num_iters ? (double)barriers / num_iters : (double)barriers, barriers);
+}
+
+void writeCSV(const char *filename, const int sizes[], double results[][15], const double barriers[], int num_sizes)
+{
+    FILE *file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error opening file for writing\n");
+        exit(1);
+    }
+
+    fprintf(file, "N, T1, T2, S2, T4, S4, T7, S7, T8, S8, T16, S16, T20, S20, T40, S40, BarriersPerIter\n");
+
+    for (int s = 0; s < num_sizes; ++s) {
+        fprintf(file, "%d", sizes[s]);
+        for (int i = 0; i < 15; ++i) {
+            fprintf(file, ",%.6f", results[s][i]);
+        }
+        fprintf(file, ",%.2f\n", barriers[s]);
+    }
+
+    fclose(file);
+}
+
+
+// Прогон всех чисел потоков с одним предобусловливателем; пишет results_3[_<name>].csv
+template <typename Preconditioner>
+void run_sweep(Preconditioner &M, const int sizes[], int num_sizes, int iters[])
+{
+    int thread_counts[8] = {1, 2, 4, 7, 8, 16, 20, 40};
+    double time_parallel, time_serial;
+    double results[5][15] = {{0}};
+    double barriers[5] = {0};
+    int num_iters;
+
+    for (int s = 0; s < num_sizes; ++s)
+    {
+        int n = sizes[s];
+        printf("n = %d\n", n);
+
+        DenseMatrix A(n, n, true);
+        std::vector<double> b(n, n + 1);
+        std::vector<double> x(n, 0.0);
+
+        // Первое касание из тех же потоков, что потом читают строки
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; ++i)
+        {
+            double *Ai = A.row(i);
+            for (int j = 0; j < n; ++j)
+                Ai[j] = 1.0;
+            Ai[i] = 2.0;
+        }
+
+        run_solve(A, b, x, M, thread_counts[0], &time_serial, &iters[s]);
+        results[s][0] = time_serial;
+        // Столько же неявных барьеров, сколько считает run_solve
+        barriers[s] = iters[s] ? (4.0 + 7.0 * iters[s]) / iters[s] : 4.0;
+
+        for (int i = 1; i < 8; ++i)
+        {
+            std::fill(x.begin(), x.end(), 0.0);
+            run_solve(A, b, x, M, thread_counts[i], &time_parallel, &num_iters);
+            results[s][2 * i - 1] = time_parallel;
+            results[s][2 * i] = time_serial / time_parallel;
+        }
+    }
+
+    char filename[64];
+    if (strcmp(M.name(), "none") == 0)
+        snprintf(filename, sizeof(filename), "results_3.csv");
+    else
+        snprintf(filename, sizeof(filename), "results_3_%s.csv", M.name());
+    writeCSV(filename, sizes, results, barriers, num_sizes);
+}
+
+int main()
+{
+    const int sizes[5] = {1000, 2000, 5000, 10000, 20000};
+    int iters[4][5] = {{0}};
+
+    IdentityPreconditioner none;
+    JacobiPreconditioner jacobi;
+    BlockJacobiPreconditioner block_jacobi;
+    BlockSSORPreconditioner block_ssor;
+
+    run_sweep(none, sizes, 5, iters[0]);
+    run_sweep(jacobi, sizes, 5, iters[1]);
+    run_sweep(block_jacobi, sizes, 5, iters[2]);
+    run_sweep(block_ssor, sizes, 5, iters[3]);
+
+    // Число итераций по предобусловливателям; время до решения - в results_3*.csv
+    FILE *file = fopen("results_3_iters.csv", "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error opening file for writing\n");
+        exit(1);
+    }
+    fprintf(file, "N, none, jacobi, block_jacobi, block_ssor\n");
+    for (int s = 0; s < 5; ++s)
+        fprintf(file, "%d,%d,%d,%d,%d\n", sizes[s], iters[0][s], iters[1][s], iters[2][s], iters[3][s]);
+    fclose(file);
+
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <omp.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "matrix.h"
+
+// Частичные скалярные произведения потока; каждая пара на своей кэш-линии
+struct alignas(64) DotSlot
+{
+    double gamma, delta;
+};
+
+// Время одного omp barrier при заданном числе потоков, в микросекундах
+double measure_barrier(int num_threads)
+{
+    const int reps = 10000;
+    double time;
+
+    omp_set_num_threads(num_threads);
+    #pragma omp parallel
+    {
+        #pragma omp barrier
+        #pragma omp master
+        time = omp_get_wtime();
+        for (int k = 0; k < reps; k++) {
+            #pragma omp barrier
+        }
+        #pragma omp master
+        time = omp_get_wtime() - time;
+    }
+    return time / reps * 1e6;
+}
+
+// Конвейерный CG (Ghysels, Vanroose): оба скалярных произведения итерации
+// (r, r) и (w, r) считаются в том же проходе, что и q = Aw, а alpha и beta
+// каждый поток вычисляет сам из частичных сумм всех потоков. Поэтому на
+// итерацию приходится два барьера (после умножения и после обновления
+// векторов) вместо семи у main3, и нет ни одного omp single.
+void run_solve(DenseMatrix &A, std::vector<double> &b, std::vector<double> &x, int num_threads, double *time,
+               double *barriers_per_iter)
+{
+    printf("Num threads: %d\n", num_threads);
+    int n = b.size();
+    double eps = 0.000001;
+    int num_iters = 0;
+    long barriers = 0;
+
+    std::vector<double> r(n), w(n), q(n), z(n, 0.0), s(n, 0.0), p(n, 0.0);
+    // Два набора слотов по чётности итерации: набор перезаписывается только
+    // через итерацию, когда все потоки его уже прочитали
+    std::vector<DotSlot> slots(2 * num_threads);
+
+    double denum = 0.0;
+    for (int i = 0; i < n; i++) {
+        denum += b[i] * b[i];
+    }
+    denum = sqrt(denum);
+
+    omp_set_num_threads(num_threads);
+    *time = omp_get_wtime();
+
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        int nth = omp_get_num_threads();
+        int lo = (long long)n * tid / nth;
+        int hi = (long long)n * (tid + 1) / nth;
+        double gamma_old = 0.0, alpha_old = 0.0;
+
+        for (int i = lo; i < hi; i++) {
+            const double *Ai = A.row(i);
+            double sum = 0;
+            for (int j = 0; j < n; j++) {
+                sum += Ai[j] * x[j];
+            }
+            r[i] = b[i] - sum;
+        }
+        #pragma omp barrier
+
+        for (int i = lo; i < hi; i++) {
+            const double *Ai = A.row(i);
+            double sum = 0;
+            for (int j = 0; j < n; j++) {
+                sum += Ai[j] * r[j];
+            }
+            w[i] = sum;
+        }
+        #pragma omp barrier
+
+        for (int it = 0; ; it++) {
+            DotSlot *set = &slots[(it % 2) * nth];
+            double gamma = 0.0, delta = 0.0;
+
+            for (int i = lo; i < hi; i++) {
+                const double *Ai = A.row(i);
+                double sum = 0;
+                for (int j = 0; j < n; j++) {
+                    sum += Ai[j] * w[j];
+                }
+                q[i] = sum;
+                gamma += r[i] * r[i];
+                delta += w[i] * r[i];
+            }
+            set[tid].gamma = gamma;
+            set[tid].delta = delta;
+            #pragma omp barrier
+
+            // Все потоки складывают слоты в одном порядке и получают одинаковые скаляры
+            gamma = 0.0, delta = 0.0;
+            for (int k = 0; k < nth; k++) {
+                gamma += set[k].gamma;
+                delta += set[k].delta;
+            }
+
+            if (sqrt(gamma) / denum <= eps) {
+                if (tid == 0) {
+                    num_iters = it;
+                    barriers += 2 * it + 3;
+                }
+                break;
+            }
+
+            double beta = 0.0, alpha;
+            if (it > 0) {
+                beta = gamma / gamma_old;
+                alpha = gamma / (delta - beta * gamma / alpha_old);
+            } else {
+                alpha = gamma / delta;
+            }
+
+            for (int i = lo; i < hi; i++) {
+                z[i] = q[i] + beta * z[i];
+                s[i] = w[i] + beta * s[i];
+                p[i] = r[i] + beta * p[i];
+                x[i] += alpha * p[i];
+                r[i] -= alpha * s[i];
+                w[i] -= alpha * z[i];
+            }
+            gamma_old = gamma;
+            alpha_old = alpha;
+            #pragma omp barrier
+        }
+    }
+
+    *time = omp_get_wtime() - *time;
+    printf("Iterations: %d\n", num_iters);
+    *barriers_per_iter = num_iters ? (double)barriers / num_iters : (double)barriers;
+    printf("Barriers per iteration: %.2f (%ld total)\n", *barriers_per_iter, barriers);
+}
+
+void writeCSV(const char *filename, const int sizes[], double results[][15], const double barriers[], int num_sizes)
+{
+    FILE *file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error opening file for writing\n");
+        exit(1);
+    }
+
+    fprintf(file, "N, T1, T2, S2, T4, S4, T7, S7, T8, S8, T16, S16, T20, S20, T40, S40, BarriersPerIter\n");
+
+    for (int s = 0; s < num_sizes; ++s) {
+        fprintf(file, "%d", sizes[s]);
+        for (int i = 0; i < 15; ++i) {
+            fprintf(file, ",%.6f", results[s][i]);
+        }
+        fprintf(file, ",%.2f\n", barriers[s]);
+    }
+
+    fclose(file);
+}
+
+
+int main()
+{
+    const int sizes[5] = {1000, 2000, 5000, 10000, 20000};
+    double time_parallel, time_serial;
+
+    int thread_counts[8] = {1, 2, 4, 7, 8, 16, 20, 40};
+    const char *filename = "results_4.csv";
+    double results[5][15] = {{0}};
+    double barriers[5] = {0};
+
+    for (int s = 0; s < 5; ++s)
+    {
+        int n = sizes[s];
+        printf("n = %d\n", n);
+
+        DenseMatrix A(n, n, true);
+        std::vector<double> b(n, n + 1);
+        std::vector<double> x(n, 0.0);
+
+        // Первое касание из тех же потоков, что потом читают строки
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; ++i)
+        {
+            double *Ai = A.row(i);
+            for (int j = 0; j < n; ++j)
+                Ai[j] = 1.0;
+            Ai[i] = 2.0;
+        }
+
+        run_solve(A, b, x, thread_counts[0], &time_serial, &barriers[s]);
+        printf("Barrier cost: %.3f us\n", measure_barrier(thread_counts[0]));
+        results[s][0] = time_serial;
+
+        for (int i = 1; i < 8; ++i)
+        {
+            std::fill(x.begin(), x.end(), 0.0);
+            run_solve(A, b, x, thread_counts[i], &time_parallel, &barriers[s]);
+            printf("Barrier cost: %.3f us\n", measure_barrier(thread_counts[i]));
+            results[s][2 * i - 1] = time_parallel;
+            results[s][2 * i] = time_serial / time_parallel;
+        }
+    }
+
+    writeCSV(filename, sizes, results, barriers, 5);
+
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <omp.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "matrix.h"
+#include "operator.h"
+#include "spectrum.h"
+
+// Итерация Ричардсона (Якоби, два буфера) для любого оператора из operator.h
+// с оптимальным шагом по оценке спектра. Для D + UV^T итерация стоит O(nk)
+// вместо O(n^2) у плотной матрицы.
+template <typename Operator>
+void run_solve(Operator &op, std::vector<double> &b, std::vector<double> &x, int num_threads, double *time)
+{
+    printf("Num threads: %d\n", num_threads);
+    int n = b.size();
+    double eps = 0.000001;
+    double criterion;
+    int num_iters = 0;
+    double num = 0, denum = 0;
+    double lmin, lmax;
+
+    std::vector<double> x_buf(x);
+    std::vector<double> res2(n);
+    double *x_old = x.data();
+    double *x_new = x_buf.data();
+
+    omp_set_num_threads(num_threads);
+    *time = omp_get_wtime();
+
+    estimate_spectrum(op, 20, &lmin, &lmax);
+    double tau = 2.0 / (lmin + lmax);
+
+    #pragma omp parallel
+    {
+        #pragma omp for reduction(+:denum)
+        for (int i = 0; i < n; i++) {
+            denum += b[i] * b[i];
+        }
+
+        do {
+            op.prepare(x_old);
+
+            #pragma omp for schedule(static)
+            for (int i = 0; i < n; i++) {
+                double diff = op.row(i, x_old) - b[i];
+                res2[i] = diff * diff;
+                x_new[i] = x_old[i] - tau * diff;
+            }
+
+            #pragma omp single
+            {
+                num = 0.0;
+                for (int i = 0; i < n; i++) {
+                    num += res2[i];
+                }
+                criterion = sqrt(num) / sqrt(denum);
+                num_iters++;
+                std::swap(x_old, x_new);
+            }
+        } while (criterion > eps);
+    }
+
+    if (x_old != x.data()) {
+        std::copy(x_old, x_old + n, x.begin());
+    }
+
+    *time = omp_get_wtime() - *time;
+    printf("Iterations: %d\n", num_iters);
+}
+
+void run_direct(DiagLowRankOperator &op, std::vector<double> &b, std::vector<double> &x, int num_threads, double *time)
+{
+    printf("Num threads (direct): %d\n", num_threads);
+
+    omp_set_num_threads(num_threads);
+    *time = omp_get_wtime();
+    if (!op.solve(b.data(), x.data())) {
+        fprintf(stderr, "Capacitance matrix is singular\n");
+        exit(1);
+    }
+    *time = omp_get_wtime() - *time;
+}
+
+// Матрица из main1/main2: I + 1 1^T, то есть D = I, U = V = столбец единиц
+void init_operator(DiagLowRankOperator &op)
+{
+    int n = op.size();
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; ++i)
+    {
+        op.d(i) = 1.0;
+        op.U(i, 0) = 1.0;
+        op.V(i, 0) = 1.0;
+    }
+}
+
+double max_diff(const std::vector<double> &x, const std::vector<double> &y)
+{
+    double diff = 0.0;
+    for (size_t i = 0; i < x.size(); ++i)
+        diff = std::max(diff, fabs(x[i] - y[i]));
+    return diff;
+}
+
+// Плотный путь остаётся эталоном: на небольшой матрице все три решения должны совпасть
+void check_against_dense(int n)
+{
+    DenseMatrix A(n, n);
+    for (int i = 0; i < n; ++i)
+    {
+        double *Ai = A.row(i);
+        for (int j = 0; j < n; ++j)
+            Ai[j] = 1.0;
+        Ai[i] = 2.0;
+    }
+    DenseOperator dense(A);
+    DiagLowRankOperator low_rank(n, 1);
+    init_operator(low_rank);
+
+    std::vector<double> b(n, n + 1);
+    std::vector<double> x_dense(n, 0.0), x_low_rank(n, 0.0), x_direct(n, 0.0);
+    double time;
+
+    run_solve(dense, b, x_dense, 1, &time);
+    run_solve(low_rank, b, x_low_rank, 1, &time);
+    run_direct(low_rank, b, x_direct, 1, &time);
+    printf("n = %d: |x_low_rank - x_dense| = %.3e, |x_direct - x_dense| = %.3e\n",
+           n, max_diff(x_low_rank, x_dense), max_diff(x_direct, x_dense));
+}
+
+void writeCSV(const char *filename, const int sizes[], double results[][15], int num_sizes)
+{
+    FILE *file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error opening file for writing\n");
+        exit(1);
+    }
+
+    fprintf(file, "N, T1, T2, S2, T4, S4, T7, S7, T8, S8, T16, S16, T20, S20, T40, S40\n");
+
+    for (int s = 0; s < num_sizes; ++s) {
+        fprintf(file, "%d", sizes[s]);
+        for (int i = 0; i < 15; ++i) {
+            fprintf(file, ",%.6f", results[s][i]);
+        }
+        fprintf(file, "\n");
+    }
+
+    fclose(file);
+}
+
+
+int main()
+{
+    const int sizes[5] = {10000, 100000, 1000000, 10000000, 20000000};
+    double time_parallel, time_serial;
+
+    int thread_counts[8] = {1, 2, 4, 7, 8, 16, 20, 40};
+    double results[5][15] = {{0}};
+    double results_direct[5][15] = {{0}};
+
+    check_against_dense(1000);
+
+    for (int s = 0; s < 5; ++s)
+    {
+        int n = sizes[s];
+        printf("n = %d\n", n);
+
+        DiagLowRankOperator op(n, 1);
+        init_operator(op);
+        std::vector<double> b(n, n + 1);
+        std::vector<double> x(n, 0.0);
+
+        run_solve(op, b, x, thread_counts[0], &time_serial);
+        results[s][0] = time_serial;
+
+        for (int i = 1; i < 8; ++i)
+        {
+            std::fill(x.begin(), x.end(), 0.0);
+            run_solve(op, b, x, thread_counts[i], &time_parallel);
+            results[s][2 * i - 1] = time_parallel;
+            results[s][2 * i] = time_serial / time_parallel;
+        }
+
+        run_direct(op, b, x, thread_counts[0], &time_serial);
+        results_direct[s][0] = time_serial;
+
+        for (int i = 1; i < 8; ++i)
+        {
+            run_direct(op, b, x, thread_counts[i], &time_parallel);
+            results_direct[s][2 * i - 1] = time_parallel;
+            results_direct[s][2 * i] = time_serial / time_parallel;
+        }
+    }
+
+    writeCSV("results_5.csv", sizes, results, 5);
+    writeCSV("results_5_direct.csv", sizes, results_direct, 5);
+
+    return 0;
+}
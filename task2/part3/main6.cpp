@@ -0,0 +1,234 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <omp.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "matrix.h"
+
+// Итерационное уточнение со смешанной точностью. Внешний цикл в double:
+// r = b - A x по исходной матрице, проверка критерия, x += d. Поправку d
+// ищет внутренний CG по float-копии A, так что основная масса матвеков
+// читает вдвое меньше байт. Внутренняя система решается для r / |r| лишь
+// до inner_eps: точность float хватает, потому что каждый внешний шаг
+// уменьшает невязку примерно в 1 / inner_eps раз.
+void run_solve(DenseMatrix &A, DenseMatrixF &Af, std::vector<double> &b, std::vector<double> &x,
+               int num_threads, double *time, int *outer, int *inner)
+{
+    printf("Num threads: %d\n", num_threads);
+    int n = b.size();
+    double eps = 0.000001;
+    double inner_eps = 0.0001;
+    int max_inner = 1000;
+    int max_outer = 100;
+    double criterion, inner_criterion;
+    int num_outer = 0, num_inner = 0, k;
+    double rr = 0.0, denum = 0.0, scale;
+    double rz = 0.0, rz_new = 0.0, pAp = 0.0;
+    float alpha, beta;
+
+    std::vector<double> r(n);
+    std::vector<float> d(n), rf(n), p(n), Ap(n);
+
+    omp_set_num_threads(num_threads);
+    *time = omp_get_wtime();
+
+    #pragma omp parallel
+    {
+        #pragma omp for reduction(+:denum)
+        for (int i = 0; i < n; i++) {
+            denum += b[i] * b[i];
+        }
+
+        while (true) {
+            // Невязка в double
+            #pragma omp for reduction(+:rr)
+            for (int i = 0; i < n; i++) {
+                const double *Ai = A.row(i);
+                double sum = 0;
+                for (int j = 0; j < n; j++) {
+                    sum += Ai[j] * x[j];
+                }
+                r[i] = b[i] - sum;
+                rr += r[i] * r[i];
+            }
+
+            #pragma omp single
+            {
+                criterion = sqrt(rr) / sqrt(denum);
+                scale = sqrt(rr);
+                rr = 0.0;
+            }
+            if (criterion <= eps)
+                break;
+            // Уточнение не сходится (A плохо обусловлена для float) - выходим
+            if (num_outer >= max_outer) {
+                #pragma omp single
+                fprintf(stderr, "Refinement stopped after %d outer iterations, criterion %e\n",
+                        num_outer, criterion);
+                break;
+            }
+
+            // Внутренний CG во float для A d = r / |r|, d0 = 0; скалярные
+            // произведения накапливаются в double
+            #pragma omp for reduction(+:rz)
+            for (int i = 0; i < n; i++) {
+                rf[i] = (float)(r[i] / scale);
+                p[i] = rf[i];
+                d[i] = 0.0f;
+                rz += (double)rf[i] * rf[i];
+            }
+
+            #pragma omp single
+            {
+                inner_criterion = sqrt(rz);
+                k = 0;
+            }
+
+            while (inner_criterion > inner_eps && k < max_inner) {
+                #pragma omp for reduction(+:pAp)
+                for (int i = 0; i < n; i++) {
+                    const float *Ai = Af.row(i);
+                    float sum = 0;
+                    for (int j = 0; j < n; j++) {
+                        sum += Ai[j] * p[j];
+                    }
+                    Ap[i] = sum;
+                    pAp += (double)p[i] * sum;
+                }
+
+                #pragma omp single
+                {
+                    alpha = (float)(rz / pAp);
+                    pAp = 0.0;
+                }
+
+                #pragma omp for reduction(+:rz_new)
+                for (int i = 0; i < n; i++) {
+                    d[i] += alpha * p[i];
+                    rf[i] -= alpha * Ap[i];
+                    rz_new += (double)rf[i] * rf[i];
+                }
+
+                #pragma omp single
+                {
+                    beta = (float)(rz_new / rz);
+                    rz = rz_new;
+                    rz_new = 0.0;
+                    inner_criterion = sqrt(rz);
+                    k++;
+                    num_inner++;
+                }
+
+                #pragma omp for
+                for (int i = 0; i < n; i++) {
+                    p[i] = rf[i] + beta * p[i];
+                }
+            }
+
+            // Поправка в double
+            #pragma omp for
+            for (int i = 0; i < n; i++) {
+                x[i] += scale * d[i];
+            }
+
+            #pragma omp single
+            {
+                rz = 0.0;
+                num_outer++;
+            }
+        }
+    }
+
+    *time = omp_get_wtime() - *time;
+    *outer = num_outer;
+    *inner = num_inner;
+    printf("Outer iterations: %d, inner iterations: %d\n", num_outer, num_inner);
+}
+
+void writeCSV(const char *filename, const int sizes[], double results[][15], int num_sizes)
+{
+    FILE *file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error opening file for writing\n");
+        exit(1);
+    }
+
+    fprintf(file, "N, T1, T2, S2, T4, S4, T7, S7, T8, S8, T16, S16, T20, S20, T40, S40\n");
+
+    for (int s = 0; s < num_sizes; ++s) {
+        fprintf(file, "%d", sizes[s]);
+        for (int i = 0; i < 15; ++i) {
+            fprintf(file, ",%.6f", results[s][i]);
+        }
+        fprintf(file, "\n");
+    }
+
+    fclose(file);
+}
+
+int main()
+{
+    // A в double и её float-копия вместе занимают 12 n^2 байт: 2.7 ГБ при
+    // n = 15000 (при 20000 было бы 4.8 ГБ), поэтому размеры как в main1/main2
+    const int sizes[5] = {1000, 2000, 5000, 10000, 15000};
+    int thread_counts[8] = {1, 2, 4, 7, 8, 16, 20, 40};
+    double time_parallel, time_serial;
+    double results[5][15] = {{0}};
+    int outer[5], inner[5];
+    int num_outer, num_inner;
+
+    for (int s = 0; s < 5; ++s)
+    {
+        int n = sizes[s];
+        printf("n = %d\n", n);
+
+        DenseMatrix A(n, n, true);
+        DenseMatrixF Af(n, n, true);
+        std::vector<double> b(n, n + 1);
+        std::vector<double> x(n, 0.0);
+
+        // Первое касание из тех же потоков, что потом читают строки;
+        // float-копия округляется из уже заполненной A
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; ++i)
+        {
+            double *Ai = A.row(i);
+            float *Afi = Af.row(i);
+            for (int j = 0; j < n; ++j)
+                Ai[j] = 1.0;
+            Ai[i] = 2.0;
+            for (int j = 0; j < n; ++j)
+                Afi[j] = (float)Ai[j];
+        }
+
+        run_solve(A, Af, b, x, thread_counts[0], &time_serial, &outer[s], &inner[s]);
+        results[s][0] = time_serial;
+
+        for (int i = 1; i < 8; ++i)
+        {
+            std::fill(x.begin(), x.end(), 0.0);
+            run_solve(A, Af, b, x, thread_counts[i], &time_parallel, &num_outer, &num_inner);
+            results[s][2 * i - 1] = time_parallel;
+            results[s][2 * i] = time_serial / time_parallel;
+        }
+    }
+
+    writeCSV("results_6.csv", sizes, results, 5);
+
+    FILE *file = fopen("results_6_iters.csv", "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error opening file for writing\n");
+        exit(1);
+    }
+    fprintf(file, "N, Outer, Inner\n");
+    for (int s = 0; s < 5; ++s)
+        fprintf(file, "%d,%d,%d\n", sizes[s], outer[s], inner[s]);
+    fclose(file);
+
+    return 0;
+}
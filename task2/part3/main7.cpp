@@ -0,0 +1,231 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <omp.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "matrix.h"
+
+const int max_rhs = 64;
+
+// CG сразу для k правых частей с одной матрицей A. Векторы хранятся по
+// строкам n x k (столбцы одной строки лежат подряд), поэтому за один проход
+// по A каждое A_ij умножается на k соседних чисел и строка A читается один
+// раз на все k решений. У каждого столбца свои alpha, beta и критерий; как
+// только столбец сходится, он переставляется в хвост и выпадает из
+// активной части [0, m), так что дальше проходы по A делаются только для
+// несошедшихся. B и X - n x k по строкам, iters[c] - число итераций столбца c.
+void run_solve(DenseMatrix &A, std::vector<double> &B, std::vector<double> &X, int k,
+               int num_threads, double *time, int iters[])
+{
+    printf("Num threads: %d, rhs: %d\n", num_threads, k);
+    int n = A.rows();
+    double eps = 0.000001;
+    int num_iters = 0;
+    int m = k;
+    int perm[max_rhs];
+    int swaps[max_rhs][2], num_swaps = 0;
+    double rr[max_rhs] = {0}, rr_new[max_rhs] = {0}, pAp[max_rhs] = {0}, denum[max_rhs] = {0};
+    double alpha[max_rhs], beta[max_rhs] = {0};
+
+    std::vector<double> W((size_t)n * k, 0.0), R((size_t)n * k), P((size_t)n * k), AP((size_t)n * k);
+
+    for (int c = 0; c < k; c++)
+        perm[c] = c;
+
+    omp_set_num_threads(num_threads);
+    *time = omp_get_wtime();
+
+    #pragma omp parallel
+    {
+        // W = 0, R = P = B
+        #pragma omp for reduction(+:rr[:max_rhs], denum[:max_rhs])
+        for (int i = 0; i < n; i++) {
+            for (int c = 0; c < k; c++) {
+                double bi = B[(size_t)i * k + c];
+                R[(size_t)i * k + c] = bi;
+                P[(size_t)i * k + c] = bi;
+                rr[c] += bi * bi;
+                denum[c] += bi * bi;
+            }
+        }
+
+        while (true) {
+            // Выкидываем сошедшиеся столбцы: каждый меняется местами с последним активным
+            #pragma omp single
+            {
+                num_swaps = 0;
+                int c = 0;
+                while (c < m) {
+                    if (rr[c] <= eps * eps * denum[c]) { // |r| / |b| <= eps, в том числе при b = 0
+                        iters[perm[c]] = num_iters;
+                        m--;
+                        std::swap(perm[c], perm[m]);
+                        std::swap(rr[c], rr[m]);
+                        std::swap(denum[c], denum[m]);
+                        std::swap(beta[c], beta[m]);
+                        swaps[num_swaps][0] = c;
+                        swaps[num_swaps][1] = m;
+                        num_swaps++;
+                    } else {
+                        c++;
+                    }
+                }
+            }
+
+            // Те же перестановки в каждой строке, затем P = R + beta P для активных
+            // столбцов; на первом проходе beta = 0 и P = R
+            #pragma omp for
+            for (int i = 0; i < n; i++) {
+                double *Ri = &R[(size_t)i * k], *Pi = &P[(size_t)i * k], *Wi = &W[(size_t)i * k];
+                for (int s = 0; s < num_swaps; s++) {
+                    std::swap(Ri[swaps[s][0]], Ri[swaps[s][1]]);
+                    std::swap(Pi[swaps[s][0]], Pi[swaps[s][1]]);
+                    std::swap(Wi[swaps[s][0]], Wi[swaps[s][1]]);
+                }
+                for (int c = 0; c < m; c++) {
+                    Pi[c] = Ri[c] + beta[c] * Pi[c];
+                }
+            }
+
+            if (m == 0)
+                break;
+
+            // Один проход по A на все активные столбцы
+            #pragma omp for reduction(+:pAp[:max_rhs])
+            for (int i = 0; i < n; i++) {
+                const double *Ai = A.row(i);
+                double sum[max_rhs] = {0};
+                for (int j = 0; j < n; j++) {
+                    double a = Ai[j];
+                    const double *Pj = &P[(size_t)j * k];
+                    for (int c = 0; c < m; c++) {
+                        sum[c] += a * Pj[c];
+                    }
+                }
+                const double *Pi = &P[(size_t)i * k];
+                for (int c = 0; c < m; c++) {
+                    AP[(size_t)i * k + c] = sum[c];
+                    pAp[c] += Pi[c] * sum[c];
+                }
+            }
+
+            #pragma omp single
+            for (int c = 0; c < m; c++) {
+                alpha[c] = rr[c] / pAp[c];
+                pAp[c] = 0.0;
+            }
+
+            #pragma omp for reduction(+:rr_new[:max_rhs])
+            for (int i = 0; i < n; i++) {
+                for (int c = 0; c < m; c++) {
+                    size_t ic = (size_t)i * k + c;
+                    W[ic] += alpha[c] * P[ic];
+                    R[ic] -= alpha[c] * AP[ic];
+                    rr_new[c] += R[ic] * R[ic];
+                }
+            }
+
+            #pragma omp single
+            {
+                for (int c = 0; c < m; c++) {
+                    beta[c] = rr_new[c] / rr[c];
+                    rr[c] = rr_new[c];
+                    rr_new[c] = 0.0;
+                }
+                num_iters++;
+            }
+        }
+
+        // Возвращаем столбцы на исходные места
+        #pragma omp for
+        for (int i = 0; i < n; i++) {
+            for (int c = 0; c < k; c++) {
+                X[(size_t)i * k + perm[c]] = W[(size_t)i * k + c];
+            }
+        }
+    }
+
+    *time = omp_get_wtime() - *time;
+    printf("Iterations: %d (max over columns)\n", num_iters);
+}
+
+void writeCSV(const char *filename, const int sizes[], int num_sizes, const int rhs_counts[], int num_rhs,
+              const int thread_counts[], int num_threads, double results[][7][8], double iters[][7])
+{
+    FILE *file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error opening file for writing\n");
+        exit(1);
+    }
+
+    fprintf(file, "N, K, Threads, Time, SolvesPerSec, Speedup, MeanIters\n");
+
+    for (int s = 0; s < num_sizes; ++s) {
+        for (int r = 0; r < num_rhs; ++r) {
+            for (int t = 0; t < num_threads; ++t) {
+                fprintf(file, "%d,%d,%d,%.6f,%.2f,%.2f,%.2f\n", sizes[s], rhs_counts[r], thread_counts[t],
+                        results[s][r][t], rhs_counts[r] / results[s][r][t], results[s][r][0] / results[s][r][t],
+                        iters[s][r]);
+            }
+        }
+    }
+
+    fclose(file);
+}
+
+int main()
+{
+    const int sizes[4] = {1000, 2000, 5000, 10000};
+    const int rhs_counts[7] = {1, 2, 4, 8, 16, 32, 64};
+    const int thread_counts[8] = {1, 2, 4, 7, 8, 16, 20, 40};
+    double results[4][7][8];
+    double mean_iters[4][7];
+    int iters[max_rhs];
+
+    for (int s = 0; s < 4; ++s)
+    {
+        int n = sizes[s];
+        printf("n = %d\n", n);
+
+        DenseMatrix A(n, n, true);
+
+        // Первое касание из тех же потоков, что потом читают строки
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; ++i)
+        {
+            double *Ai = A.row(i);
+            for (int j = 0; j < n; ++j)
+                Ai[j] = 1.0;
+            Ai[i] = 2.0;
+        }
+
+        for (int r = 0; r < 7; ++r)
+        {
+            int k = rhs_counts[r];
+            // Столбец c: b = n + 1 плюс возмущение, своё у каждого столбца
+            std::vector<double> B((size_t)n * k), X((size_t)n * k);
+            for (int i = 0; i < n; ++i)
+                for (int c = 0; c < k; ++c)
+                    B[(size_t)i * k + c] = n + 1 + c * sin(i + 1.0);
+
+            for (int t = 0; t < 8; ++t)
+            {
+                run_solve(A, B, X, k, thread_counts[t], &results[s][r][t], iters);
+                printf("%.2f solves/sec\n", k / results[s][r][t]);
+            }
+
+            double sum = 0;
+            for (int c = 0; c < k; ++c)
+                sum += iters[c];
+            mean_iters[s][r] = sum / k;
+        }
+    }
+
+    writeCSV("results_7.csv", sizes, 4, rhs_counts, 7, thread_counts, 8, results, mean_iters);
+
+    return 0;
+}
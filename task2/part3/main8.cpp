@@ -0,0 +1,169 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <omp.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "operator.h"
+#include "sparse.h"
+
+// CG из main3 для оператора из operator.h: здесь - для разреженной матрицы,
+// загруженной из файла Matrix Market. Матрица должна быть симметричной и
+// положительно определённой; на реальных задачах число итераций может быть
+// большим, поэтому оно ограничено max_iters.
+template <typename Operator>
+void run_solve(Operator &op, std::vector<double> &b, std::vector<double> &x, int num_threads, double *time)
+{
+    printf("Num threads: %d\n", num_threads);
+    int n = b.size();
+    double eps = 0.000001;
+    int max_iters = 100000;
+    double criterion;
+    int num_iters = 0;
+    double rr = 0.0, rr_new = 0.0, pAp = 0.0, denum = 0.0;
+    double alpha, beta;
+
+    std::vector<double> r(n), p(n), Ap(n);
+
+    omp_set_num_threads(num_threads);
+    *time = omp_get_wtime();
+
+    #pragma omp parallel
+    {
+        op.prepare(x.data());
+
+        #pragma omp for reduction(+:rr, denum)
+        for (int i = 0; i < n; i++) {
+            r[i] = b[i] - op.row(i, x.data());
+            p[i] = r[i];
+            rr += r[i] * r[i];
+            denum += b[i] * b[i];
+        }
+
+        #pragma omp single
+        criterion = sqrt(rr) / sqrt(denum);
+
+        while (criterion > eps && num_iters < max_iters) {
+            op.prepare(p.data());
+
+            #pragma omp for reduction(+:pAp)
+            for (int i = 0; i < n; i++) {
+                Ap[i] = op.row(i, p.data());
+                pAp += p[i] * Ap[i];
+            }
+
+            #pragma omp single
+            {
+                alpha = rr / pAp;
+                pAp = 0.0;
+            }
+
+            #pragma omp for reduction(+:rr_new)
+            for (int i = 0; i < n; i++) {
+                x[i] += alpha * p[i];
+                r[i] -= alpha * Ap[i];
+                rr_new += r[i] * r[i];
+            }
+
+            #pragma omp single
+            {
+                beta = rr_new / rr;
+                rr = rr_new;
+                rr_new = 0.0;
+                criterion = sqrt(rr) / sqrt(denum);
+                num_iters++;
+            }
+
+            #pragma omp for
+            for (int i = 0; i < n; i++) {
+                p[i] = r[i] + beta * p[i];
+            }
+        }
+    }
+
+    *time = omp_get_wtime() - *time;
+    printf("Iterations: %d%s\n", num_iters, criterion > eps ? " (not converged)" : "");
+}
+
+void writeCSV(const char *filename, const int sizes[], double results[][15], int num_sizes)
+{
+    FILE *file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error opening file for writing\n");
+        exit(1);
+    }
+
+    fprintf(file, "N, T1, T2, S2, T4, S4, T7, S7, T8, S8, T16, S16, T20, S20, T40, S40\n");
+
+    for (int s = 0; s < num_sizes; ++s) {
+        fprintf(file, "%d", sizes[s]);
+        for (int i = 0; i < 15; ++i) {
+            fprintf(file, ",%.6f", results[s][i]);
+        }
+        fprintf(file, "\n");
+    }
+
+    fclose(file);
+}
+
+
+// Использование: main8 matrix.mtx. Правая часть b = A * 1, так что точное
+// решение известно и по нему проверяется ответ.
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s matrix.mtx\n", argv[0]);
+        return 1;
+    }
+
+    double time_load = omp_get_wtime();
+    CsrMatrix A;
+    if (!load_matrix_market(argv[1], A))
+        return 1;
+    time_load = omp_get_wtime() - time_load;
+
+    int n = A.rows();
+    if (A.cols() != n)
+    {
+        fprintf(stderr, "Matrix must be square, got %d x %d\n", n, A.cols());
+        return 1;
+    }
+    printf("Loaded %d x %d, nnz = %lld in %.3f s\n", n, n, (long long)A.nnz(), time_load);
+
+    CsrOperator op(A);
+    std::vector<double> ones(n, 1.0);
+    std::vector<double> b(n);
+    std::vector<double> x(n, 0.0);
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; ++i)
+        b[i] = op.row(i, ones.data());
+
+    int thread_counts[8] = {1, 2, 4, 7, 8, 16, 20, 40};
+    double time_parallel, time_serial;
+    double results[1][15] = {{0}};
+
+    run_solve(op, b, x, thread_counts[0], &time_serial);
+    results[0][0] = time_serial;
+
+    for (int i = 1; i < 8; ++i)
+    {
+        std::fill(x.begin(), x.end(), 0.0);
+        run_solve(op, b, x, thread_counts[i], &time_parallel);
+        results[0][2 * i - 1] = time_parallel;
+        results[0][2 * i] = time_serial / time_parallel;
+    }
+
+    double err = 0.0;
+    for (int i = 0; i < n; ++i)
+        err = std::max(err, fabs(x[i] - 1.0));
+    printf("max |x - 1| = %.3e\n", err);
+
+    writeCSV("results_8.csv", &n, results, 1);
+
+    return 0;
+}
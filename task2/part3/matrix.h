@@ -0,0 +1,61 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+
+// Плотная матрица в одном непрерывном буфере, выровненном на 64 байта.
+// Длина строки дополняется до целой кэш-линии (и не кратна 4 КБ, чтобы
+// начала строк не попадали в одни и те же наборы кэша), поэтому каждая
+// строка начинается с выровненного адреса и внутренний цикл векторизуется.
+// С huge_pages буфер выравнивается на 2 МБ и помечается MADV_HUGEPAGE.
+// Тип элемента - параметр шаблона: float-копия нужна смешанной точности.
+template <typename T>
+class BasicDenseMatrix
+{
+public:
+    BasicDenseMatrix(int rows, int cols, bool huge_pages = false)
+        : rows_(rows), cols_(cols)
+    {
+        const size_t line = 64 / sizeof(T);
+        stride_ = (cols + line - 1) / line * line;
+        if (stride_ % (4096 / sizeof(T)) == 0)
+            stride_ += line;
+
+        size_t bytes = sizeof(T) * stride_ * rows;
+        size_t align = huge_pages ? (2u << 20) : 64;
+        void *ptr = nullptr;
+        if (posix_memalign(&ptr, align, bytes) != 0)
+            throw std::bad_alloc();
+        if (huge_pages)
+            madvise(ptr, bytes, MADV_HUGEPAGE);
+        data_ = static_cast<T *>(ptr);
+    }
+
+    ~BasicDenseMatrix() { free(data_); }
+
+    BasicDenseMatrix(const BasicDenseMatrix &) = delete;
+    BasicDenseMatrix &operator=(const BasicDenseMatrix &) = delete;
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    size_t stride() const { return stride_; }
+
+    T *row(int i) { return data_ + stride_ * i; }
+    const T *row(int i) const { return data_ + stride_ * i; }
+
+    T &operator()(int i, int j) { return data_[stride_ * i + j]; }
+    T operator()(int i, int j) const { return data_[stride_ * i + j]; }
+
+private:
+    int rows_, cols_;
+    size_t stride_;
+    T *data_;
+};
+
+typedef BasicDenseMatrix<double> DenseMatrix;
+typedef BasicDenseMatrix<float> DenseMatrixF;
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef OPERATOR_H
+#define OPERATOR_H
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+
+#include "matrix.h"
+
+// Линейный оператор для итерационных решателей. Строка i произведения Op x
+// берётся через row(i, x), но перед проходом по строкам все потоки
+// параллельной области должны вызвать prepare(x): там оператор считает то,
+// что нужно всем строкам сразу. Оба метода вызываются внутри omp parallel.
+// Разреженный CsrOperator с тем же интерфейсом - в sparse.h.
+
+// Плотная матрица: prepare ничего не делает, строка - скалярное произведение
+class DenseOperator
+{
+public:
+    explicit DenseOperator(const DenseMatrix &A) : A_(A) {}
+
+    int size() const { return A_.rows(); }
+
+    void prepare(const double *) {}
+
+    double row(int i, const double *x) const
+    {
+        const double *Ai = A_.row(i);
+        int n = A_.cols();
+        double sum = 0;
+        for (int j = 0; j < n; j++) {
+            sum += Ai[j] * x[j];
+        }
+        return sum;
+    }
+
+    double diag(int i) const { return A_(i, i); }
+
+private:
+    const DenseMatrix &A_;
+};
+
+// D + U V^T, где D диагональна, а U и V - n x k (строки лежат подряд).
+// prepare считает c = V^T x за O(nk), после чего строка стоит O(k):
+// (Op x)_i = d_i x_i + sum_l U_il c_l.
+class DiagLowRankOperator
+{
+public:
+    DiagLowRankOperator(int n, int k) : n_(n), k_(k), d_(n), U_((size_t)n * k), V_((size_t)n * k), c_(k) {}
+
+    int size() const { return n_; }
+    int rank() const { return k_; }
+
+    double &d(int i) { return d_[i]; }
+    double &U(int i, int l) { return U_[(size_t)i * k_ + l]; }
+    double &V(int i, int l) { return V_[(size_t)i * k_ + l]; }
+
+    void prepare(const double *x)
+    {
+        int tid = omp_get_thread_num();
+        size_t lines = ((size_t)k_ + 7) / 8, stride = lines * 8;
+
+        #pragma omp single
+        partial_.assign((size_t)omp_get_num_threads() * lines, CacheLine());
+        double *slots = partial_[0].v;
+
+        // Сумма копится в локальном массиве и пишется в свой слот один раз
+        std::vector<double> acc(k_, 0.0);
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < n_; i++) {
+            const double *Vi = &V_[(size_t)i * k_];
+            for (int l = 0; l < k_; l++) {
+                acc[l] += Vi[l] * x[i];
+            }
+        }
+        std::copy(acc.begin(), acc.end(), slots + (size_t)tid * stride);
+
+        // Частичные суммы потоков складываются в фиксированном порядке
+        #pragma omp barrier
+        #pragma omp single
+        {
+            int nth = omp_get_num_threads();
+            for (int l = 0; l < k_; l++) {
+                double sum = 0.0;
+                for (int t = 0; t < nth; t++) {
+                    sum += slots[(size_t)t * stride + l];
+                }
+                c_[l] = sum;
+            }
+        }
+    }
+
+    double row(int i, const double *x) const
+    {
+        const double *Ui = &U_[(size_t)i * k_];
+        double sum = d_[i] * x[i];
+        for (int l = 0; l < k_; l++) {
+            sum += Ui[l] * c_[l];
+        }
+        return sum;
+    }
+
+    double diag(int i) const
+    {
+        double sum = d_[i];
+        for (int l = 0; l < k_; l++) {
+            sum += U_[(size_t)i * k_ + l] * V_[(size_t)i * k_ + l];
+        }
+        return sum;
+    }
+
+    // Прямое решение по формуле Шермана - Моррисона - Вудбери:
+    // x = D^-1 b - D^-1 U (I + V^T D^-1 U)^-1 V^T D^-1 b, всего O(nk^2 + k^3).
+    // Возвращает false, если матрица ёмкости I + V^T D^-1 U вырождена.
+    bool solve(const double *b, double *x) const
+    {
+        int k = k_;
+        std::vector<double> M((size_t)k * k, 0.0), rhs(k, 0.0), z(k);
+
+        #pragma omp parallel
+        {
+            std::vector<double> M_loc((size_t)k * k, 0.0), rhs_loc(k, 0.0);
+
+            #pragma omp for schedule(static)
+            for (int i = 0; i < n_; i++) {
+                const double *Ui = &U_[(size_t)i * k];
+                const double *Vi = &V_[(size_t)i * k];
+                double inv_d = 1.0 / d_[i];
+                x[i] = b[i] * inv_d;
+                for (int l = 0; l < k; l++) {
+                    rhs_loc[l] += Vi[l] * x[i];
+                    for (int m = 0; m < k; m++) {
+                        M_loc[(size_t)l * k + m] += Vi[l] * inv_d * Ui[m];
+                    }
+                }
+            }
+
+            #pragma omp critical
+            {
+                for (size_t l = 0; l < M.size(); l++) {
+                    M[l] += M_loc[l];
+                }
+                for (int l = 0; l < k; l++) {
+                    rhs[l] += rhs_loc[l];
+                }
+            }
+        }
+
+        for (int l = 0; l < k; l++) {
+            M[(size_t)l * k + l] += 1.0;
+        }
+
+        // Гаусс с выбором главного элемента для маленькой системы k x k
+        for (int col = 0; col < k; col++) {
+            int piv = col;
+            for (int r = col + 1; r < k; r++) {
+                if (fabs(M[(size_t)r * k + col]) > fabs(M[(size_t)piv * k + col])) piv = r;
+            }
+            if (M[(size_t)piv * k + col] == 0.0) return false;
+            if (piv != col) {
+                for (int m = 0; m < k; m++) std::swap(M[(size_t)piv * k + m], M[(size_t)col * k + m]);
+                std::swap(rhs[piv], rhs[col]);
+            }
+            for (int r = col + 1; r < k; r++) {
+                double f = M[(size_t)r * k + col] / M[(size_t)col * k + col];
+                for (int m = col; m < k; m++) M[(size_t)r * k + m] -= f * M[(size_t)col * k + m];
+                rhs[r] -= f * rhs[col];
+            }
+        }
+        for (int r = k - 1; r >= 0; r--) {
+            double sum = rhs[r];
+            for (int m = r + 1; m < k; m++) sum -= M[(size_t)r * k + m] * z[m];
+            z[r] = sum / M[(size_t)r * k + r];
+        }
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n_; i++) {
+            const double *Ui = &U_[(size_t)i * k];
+            double sum = 0.0;
+            for (int l = 0; l < k; l++) {
+                sum += Ui[l] * z[l];
+            }
+            x[i] -= sum / d_[i];
+        }
+        return true;
+    }
+
+private:
+    // Слот потока в partial_ - целое число кэш-линий, как DotSlot в main4
+    struct alignas(64) CacheLine
+    {
+        double v[8];
+    };
+
+    int n_, k_;
+    std::vector<double> d_, U_, V_;
+    std::vector<double> c_;
+    std::vector<CacheLine> partial_;
+};
+
+#endif
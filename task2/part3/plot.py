@@ -1,23 +1,27 @@
+import sys
+
 import matplotlib.pyplot as plt
 import pandas as pd
 
-df = pd.read_csv("results_2.csv")
+# python plot.py [results_N.csv] -> speedup_plot_N.png
+filename = sys.argv[1] if len(sys.argv) > 1 else "results_2.csv"
+df = pd.read_csv(filename, skipinitialspace=True)
 
 threads = [1, 2, 4, 7, 8, 16, 20, 40]
 ideal_speedup = [1, 2, 4, 7, 8, 16, 20, 40]
 
-speedup_20k = [1.0] + [df.iloc[0, column] for column in range(2, 15, 2)]
-
 plt.figure(figsize=(5, 5))
-plt.plot(threads, speedup_20k, marker='o', label='n=1000')
+for row in range(len(df)):
+    speedup = [1.0] + [df.iloc[row, column] for column in range(3, 16, 2)]
+    plt.plot(threads, speedup, marker='o', label=f'n={df.iloc[row, 0]}')
 plt.plot(threads, ideal_speedup, 'r--', label='perfect acceleration')
 
 plt.xlabel("Number of threads")
 plt.ylabel("SpeedUp")
 plt.xticks(threads)
+plt.legend()
 plt.tight_layout()
 plt.axis("equal")
 plt.grid()
 
-plt.savefig("speedup_plot_2.png")
-
+plt.savefig(filename.replace("results", "speedup_plot").replace(".csv", ".png"))
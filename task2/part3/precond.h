@@ -0,0 +1,227 @@
+#ifndef PRECOND_H
+#define PRECOND_H
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+
+#include "matrix.h"
+
+// Предобусловливатели для CG. setup(A) вызывается один раз до решения, а
+// apply(r, z) (z = M^-1 r) - всеми потоками внутри параллельной области:
+// внутри стоит omp for с неявным барьером в конце. Блочные варианты режут
+// матрицу на диагональные блоки по block_size строк; блоки раздаются потокам
+// статически, так что каждый поток работает только со своими строками.
+
+const int block_size = 64;
+
+class IdentityPreconditioner
+{
+public:
+    const char *name() const { return "none"; }
+
+    void setup(const DenseMatrix &A) { n_ = A.rows(); }
+
+    void apply(const double *r, double *z) const
+    {
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n_; i++) {
+            z[i] = r[i];
+        }
+    }
+
+private:
+    int n_ = 0;
+};
+
+// M = diag(A)
+class JacobiPreconditioner
+{
+public:
+    const char *name() const { return "jacobi"; }
+
+    void setup(const DenseMatrix &A)
+    {
+        int n = A.rows();
+        inv_diag_.resize(n);
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; i++) {
+            inv_diag_[i] = 1.0 / A(i, i);
+        }
+    }
+
+    void apply(const double *r, double *z) const
+    {
+        int n = inv_diag_.size();
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n; i++) {
+            z[i] = inv_diag_[i] * r[i];
+        }
+    }
+
+private:
+    std::vector<double> inv_diag_;
+};
+
+// M = блочная диагональ A; каждый блок заранее раскладывается по Холецкому
+class BlockJacobiPreconditioner
+{
+public:
+    const char *name() const { return "block_jacobi"; }
+
+    void setup(const DenseMatrix &A)
+    {
+        n_ = A.rows();
+        num_blocks_ = (n_ + block_size - 1) / block_size;
+        factors_.assign((size_t)num_blocks_ * block_size * block_size, 0.0);
+
+        #pragma omp parallel for schedule(static)
+        for (int blk = 0; blk < num_blocks_; blk++) {
+            int lo = blk * block_size;
+            int bs = std::min(block_size, n_ - lo);
+            double *L = &factors_[(size_t)blk * block_size * block_size];
+
+            for (int i = 0; i < bs; i++) {
+                for (int j = 0; j <= i; j++) {
+                    double sum = A(lo + i, lo + j);
+                    for (int k = 0; k < j; k++) {
+                        sum -= L[i * block_size + k] * L[j * block_size + k];
+                    }
+                    if (i == j) {
+                        if (sum <= 0.0) {
+                            fprintf(stderr, "Block %d is not positive definite\n", blk);
+                            exit(1);
+                        }
+                        L[i * block_size + i] = sqrt(sum);
+                    } else {
+                        L[i * block_size + j] = sum / L[j * block_size + j];
+                    }
+                }
+            }
+        }
+    }
+
+    void apply(const double *r, double *z) const
+    {
+        #pragma omp for schedule(static)
+        for (int blk = 0; blk < num_blocks_; blk++) {
+            int lo = blk * block_size;
+            int bs = std::min(block_size, n_ - lo);
+            const double *L = &factors_[(size_t)blk * block_size * block_size];
+
+            for (int i = 0; i < bs; i++) {
+                double sum = r[lo + i];
+                for (int k = 0; k < i; k++) {
+                    sum -= L[i * block_size + k] * z[lo + k];
+                }
+                z[lo + i] = sum / L[i * block_size + i];
+            }
+            for (int i = bs - 1; i >= 0; i--) {
+                double sum = z[lo + i];
+                for (int k = i + 1; k < bs; k++) {
+                    sum -= L[k * block_size + i] * z[lo + k];
+                }
+                z[lo + i] = sum / L[i * block_size + i];
+            }
+        }
+    }
+
+private:
+    int n_ = 0, num_blocks_ = 0;
+    std::vector<double> factors_;
+};
+
+// Симметричная последовательная верхняя релаксация внутри каждого диагонального
+// блока: M^-1 = (2 - w) / w * (D/w + U)^-1 (D/w) (D/w + L)^-1. Прямой и обратный
+// ход не выходят за пределы блока, поэтому блоки обрабатываются независимо.
+class BlockSSORPreconditioner
+{
+public:
+    explicit BlockSSORPreconditioner(double omega = 1.0) : omega_(omega) {}
+
+    const char *name() const { return "block_ssor"; }
+
+    void setup(const DenseMatrix &A) { A_ = &A; }
+
+    void apply(const double *r, double *z) const
+    {
+        const DenseMatrix &A = *A_;
+        int n = A.rows();
+        int num_blocks = (n + block_size - 1) / block_size;
+        double w = omega_;
+
+        #pragma omp for schedule(static)
+        for (int blk = 0; blk < num_blocks; blk++) {
+            int lo = blk * block_size;
+            int hi = std::min(lo + block_size, n);
+
+            for (int i = lo; i < hi; i++) {
+                const double *Ai = A.row(i);
+                double sum = r[i];
+                for (int k = lo; k < i; k++) {
+                    sum -= Ai[k] * z[k];
+                }
+                z[i] = sum * w / Ai[i];
+            }
+            for (int i = lo; i < hi; i++) {
+                z[i] *= A(i, i) / w;
+            }
+            for (int i = hi - 1; i >= lo; i--) {
+                const double *Ai = A.row(i);
+                double sum = z[i];
+                for (int k = i + 1; k < hi; k++) {
+                    sum -= Ai[k] * z[k];
+                }
+                z[i] = sum * w / Ai[i];
+            }
+            for (int i = lo; i < hi; i++) {
+                z[i] *= (2.0 - w) / w;
+            }
+        }
+    }
+
+private:
+    double omega_;
+    const DenseMatrix *A_ = nullptr;
+};
+
+// M^-1 A в виде оператора из operator.h, чтобы оценивать его спектр тем же
+// степенным методом, что и спектр A: prepare(x) считает y = Ax и z = M^-1 y,
+// а строка i - это просто z[i]. M^-1 A подобна симметричной M^-1/2 A M^-1/2,
+// поэтому собственные числа у неё вещественные и положительные.
+template <typename Preconditioner>
+class PreconditionedOperator
+{
+public:
+    PreconditionedOperator(const DenseMatrix &A, const Preconditioner &M)
+        : A_(A), M_(M), y_(A.rows()), z_(A.rows()) {}
+
+    int size() const { return A_.rows(); }
+
+    void prepare(const double *x)
+    {
+        int n = A_.rows();
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n; i++) {
+            const double *Ai = A_.row(i);
+            double sum = 0;
+            for (int j = 0; j < n; j++) {
+                sum += Ai[j] * x[j];
+            }
+            y_[i] = sum;
+        }
+        M_.apply(y_.data(), z_.data());
+    }
+
+    double row(int i, const double *) const { return z_[i]; }
+
+private:
+    const DenseMatrix &A_;
+    const Preconditioner &M_;
+    std::vector<double> y_, z_;
+};
+
+#endif
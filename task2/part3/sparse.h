@@ -0,0 +1,453 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Разреженная матрица в формате CSR, отображённая из двоичного файла-кэша.
+// Файл Matrix Market (*.mtx) разбирается один раз, результат пишется рядом
+// в <имя>.csr, а последующие запуски просто делают mmap этого файла: массивы
+// используются прямо из отображения, без копирования и разбора.
+//
+// Формат кэша: CsrHeader, затем row_ptr (rows + 1 x int64), col (nnz x int32,
+// дополнено до 8 байт) и val (nnz x double).
+
+struct CsrHeader
+{
+    char magic[8];
+    int64_t rows, cols, nnz;
+};
+
+static const char csr_magic[8] = {'C', 'S', 'R', 'B', 'I', 'N', '1', '\0'};
+
+class CsrMatrix
+{
+public:
+    CsrMatrix() {}
+    ~CsrMatrix()
+    {
+        if (map_)
+            munmap(map_, map_size_);
+    }
+
+    CsrMatrix(const CsrMatrix &) = delete;
+    CsrMatrix &operator=(const CsrMatrix &) = delete;
+
+    int rows() const { return (int)rows_; }
+    int cols() const { return (int)cols_; }
+    int64_t nnz() const { return nnz_; }
+
+    const int64_t *row_ptr() const { return row_ptr_; }
+    const int32_t *col() const { return col_; }
+    const double *val() const { return val_; }
+
+    // Отображает готовый кэш; false, если файла нет или он повреждён
+    bool map(const char *path)
+    {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CsrHeader))
+        {
+            close(fd);
+            return false;
+        }
+        void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED)
+            return false;
+
+        const CsrHeader *h = static_cast<const CsrHeader *>(ptr);
+        size_t expected = sizeof(CsrHeader) + sizeof(int64_t) * (h->rows + 1) +
+                          col_bytes(h->nnz) + sizeof(double) * h->nnz;
+        if (memcmp(h->magic, csr_magic, sizeof(csr_magic)) != 0 || expected != (size_t)st.st_size)
+        {
+            munmap(ptr, st.st_size);
+            return false;
+        }
+        madvise(ptr, st.st_size, MADV_WILLNEED);
+
+        if (map_)
+            munmap(map_, map_size_);
+        map_ = ptr;
+        map_size_ = st.st_size;
+        rows_ = h->rows;
+        cols_ = h->cols;
+        nnz_ = h->nnz;
+        char *base = static_cast<char *>(ptr) + sizeof(CsrHeader);
+        row_ptr_ = reinterpret_cast<const int64_t *>(base);
+        col_ = reinterpret_cast<const int32_t *>(base + sizeof(int64_t) * (rows_ + 1));
+        val_ = reinterpret_cast<const double *>(base + sizeof(int64_t) * (rows_ + 1) + col_bytes(nnz_));
+        return true;
+    }
+
+    static size_t col_bytes(int64_t nnz) { return (sizeof(int32_t) * nnz + 7) / 8 * 8; }
+
+private:
+    void *map_ = nullptr;
+    size_t map_size_ = 0;
+    int64_t rows_ = 0, cols_ = 0, nnz_ = 0;
+    const int64_t *row_ptr_ = nullptr;
+    const int32_t *col_ = nullptr;
+    const double *val_ = nullptr;
+};
+
+// Оператор для решателей из operator.h поверх CsrMatrix: строка стоит
+// O(nnz в строке)
+class CsrOperator
+{
+public:
+    explicit CsrOperator(const CsrMatrix &A) : A_(A) {}
+
+    int size() const { return A_.rows(); }
+
+    void prepare(const double *) {}
+
+    double row(int i, const double *x) const
+    {
+        const int64_t *row_ptr = A_.row_ptr();
+        const int32_t *col = A_.col();
+        const double *val = A_.val();
+        double sum = 0;
+        for (int64_t k = row_ptr[i]; k < row_ptr[i + 1]; k++) {
+            sum += val[k] * x[col[k]];
+        }
+        return sum;
+    }
+
+    // Столбцы в строке отсортированы, поэтому диагональ ищется бинарным поиском
+    double diag(int i) const
+    {
+        const int32_t *first = A_.col() + A_.row_ptr()[i];
+        const int32_t *last = A_.col() + A_.row_ptr()[i + 1];
+        const int32_t *it = std::lower_bound(first, last, i);
+        return (it != last && *it == i) ? A_.val()[it - A_.col()] : 0.0;
+    }
+
+private:
+    const CsrMatrix &A_;
+};
+
+// Пропускает пробелы и табуляции; возвращает false на конце строки
+inline bool mm_skip(const char *&p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p < end && *p != '\n';
+}
+
+template <typename T>
+inline bool mm_number(const char *&p, const char *end, T &value)
+{
+    if (!mm_skip(p, end))
+        return false;
+    // from_chars не принимает явный плюс, а в *.mtx он встречается
+    if (*p == '+' && p + 1 < end && p[1] != '-')
+        p++;
+    std::from_chars_result res = std::from_chars(p, end, value);
+    if (res.ec != std::errc())
+        return false;
+    p = res.ptr;
+    return true;
+}
+
+// Разбирает *.mtx (coordinate, real/integer/pattern, general/symmetric/
+// skew-symmetric) и пишет кэш CSR. Текст отображается в память и режется на
+// куски по числу потоков с границами на переводах строк; каждый поток
+// разбирает свой кусок через std::from_chars в собственные тройки.
+inline bool mm_convert(const char *mtx_path, const char *cache_path)
+{
+    int fd = open(mtx_path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror(mtx_path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        fprintf(stderr, "%s: empty file\n", mtx_path);
+        close(fd);
+        return false;
+    }
+    void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        perror("mmap");
+        return false;
+    }
+    madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+    const char *text = static_cast<const char *>(ptr);
+    const char *end = text + st.st_size;
+
+    // Заголовок: %%MatrixMarket matrix coordinate <field> <symmetry>
+    const char *eol = static_cast<const char *>(memchr(text, '\n', end - text));
+    std::string banner(text, eol ? eol : end);
+    for (char &ch : banner)
+        ch = (char)tolower((unsigned char)ch);
+    bool pattern = banner.find(" pattern") != std::string::npos;
+    bool skew = banner.find("skew-symmetric") != std::string::npos;
+    bool symmetric = skew || banner.find("symmetric") != std::string::npos;
+    if (banner.compare(0, 14, "%%matrixmarket") != 0 || banner.find("coordinate") == std::string::npos ||
+        banner.find("complex") != std::string::npos || banner.find("hermitian") != std::string::npos)
+    {
+        fprintf(stderr, "%s: only real coordinate Matrix Market files are supported\n", mtx_path);
+        munmap(ptr, st.st_size);
+        return false;
+    }
+
+    // Комментарии, затем строка размеров
+    const char *p = text;
+    while (p < end && *p == '%')
+    {
+        const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+        p = nl ? nl + 1 : end;
+    }
+    int64_t rows, cols, entries;
+    if (!mm_number(p, end, rows) || !mm_number(p, end, cols) || !mm_number(p, end, entries) ||
+        rows <= 0 || cols <= 0 || entries < 0 || rows > INT32_MAX || cols > INT32_MAX)
+    {
+        fprintf(stderr, "%s: bad size line\n", mtx_path);
+        munmap(ptr, st.st_size);
+        return false;
+    }
+    const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+    const char *data = nl ? nl + 1 : end;
+
+    int nth = omp_get_max_threads();
+    std::vector<std::vector<int32_t>> ti(nth), tj(nth);
+    std::vector<std::vector<double>> tv(nth);
+    std::vector<int64_t> row_count(rows + 1, 0);
+    int64_t parsed = 0;
+    bool failed = false;
+
+    #pragma omp parallel num_threads(nth) reduction(+:parsed)
+    {
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        size_t len = end - data;
+
+        // Кусок [lo, hi) начинается после перевода строки, предшествующего его началу
+        const char *lo = data + len * tid / nthreads;
+        const char *hi = data + len * (tid + 1) / nthreads;
+        if (tid > 0)
+            while (lo < end && lo[-1] != '\n')
+                lo++;
+        if (tid < nthreads - 1)
+            while (hi < end && hi[-1] != '\n')
+                hi++;
+
+        std::vector<int32_t> &I = ti[tid], &J = tj[tid];
+        std::vector<double> &V = tv[tid];
+        I.reserve((size_t)(entries / nthreads + 1) * (symmetric ? 2 : 1));
+        J.reserve(I.capacity());
+        V.reserve(I.capacity());
+
+        const char *q = lo;
+        while (q < hi)
+        {
+            int64_t i, j;
+            double v = 1.0;
+            if (!mm_skip(q, hi) || *q == '%')
+            {
+                // Пустая строка или комментарий
+            }
+            else if (!mm_number(q, hi, i) || !mm_number(q, hi, j) || (!pattern && !mm_number(q, hi, v)) ||
+                     i < 1 || i > rows || j < 1 || j > cols)
+            {
+                #pragma omp atomic write
+                failed = true;
+            }
+            else
+            {
+                parsed++;
+                I.push_back((int32_t)(i - 1));
+                J.push_back((int32_t)(j - 1));
+                V.push_back(v);
+                if (symmetric && i != j)
+                {
+                    I.push_back((int32_t)(j - 1));
+                    J.push_back((int32_t)(i - 1));
+                    V.push_back(skew ? -v : v);
+                }
+            }
+            const char *next = static_cast<const char *>(memchr(q, '\n', hi - q));
+            q = next ? next + 1 : hi;
+        }
+
+        for (size_t e = 0; e < I.size(); e++)
+        {
+            #pragma omp atomic
+            row_count[I[e] + 1]++;
+        }
+    }
+    munmap(ptr, st.st_size);
+
+    if (failed)
+    {
+        fprintf(stderr, "%s: malformed entry\n", mtx_path);
+        return false;
+    }
+    if (parsed != entries)
+    {
+        fprintf(stderr, "%s: header promises %lld entries, file has %lld\n", mtx_path,
+                (long long)entries, (long long)parsed);
+        return false;
+    }
+
+    for (int64_t i = 0; i < rows; i++)
+        row_count[i + 1] += row_count[i];
+    int64_t nnz = row_count[rows];
+
+    // Файл кэша сразу нужного размера; массивы заполняются прямо в отображении
+    std::string tmp_path = std::string(cache_path) + ".tmp";
+    size_t size = sizeof(CsrHeader) + sizeof(int64_t) * (rows + 1) + CsrMatrix::col_bytes(nnz) + sizeof(double) * nnz;
+    fd = open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, size) != 0)
+    {
+        perror(tmp_path.c_str());
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        perror("mmap");
+        return false;
+    }
+
+    CsrHeader *h = static_cast<CsrHeader *>(ptr);
+    memcpy(h->magic, csr_magic, sizeof(csr_magic));
+    h->rows = rows;
+    h->cols = cols;
+    h->nnz = nnz;
+    char *base = static_cast<char *>(ptr) + sizeof(CsrHeader);
+    int64_t *row_ptr = reinterpret_cast<int64_t *>(base);
+    int32_t *col = reinterpret_cast<int32_t *>(base + sizeof(int64_t) * (rows + 1));
+    double *val = reinterpret_cast<double *>(base + sizeof(int64_t) * (rows + 1) + CsrMatrix::col_bytes(nnz));
+    memcpy(row_ptr, row_count.data(), sizeof(int64_t) * (rows + 1));
+
+    std::vector<int64_t> &next = row_count; // Позиция записи в каждой строке
+    std::vector<int64_t> unique(rows);      // Элементов в строке после слияния повторов
+
+    #pragma omp parallel num_threads(nth)
+    {
+        int tid = omp_get_thread_num();
+        for (size_t e = 0; e < ti[tid].size(); e++)
+        {
+            int64_t pos;
+            #pragma omp atomic capture
+            pos = next[ti[tid][e]]++;
+            col[pos] = tj[tid][e];
+            val[pos] = tv[tid][e];
+        }
+
+        #pragma omp barrier
+
+        // Порядок внутри строки зависел от потоков; сортировка по столбцу делает файл детерминированным.
+        // Повторные (i, j) по соглашению Matrix Market складываются
+        std::vector<std::pair<int32_t, double>> tmp;
+        #pragma omp for schedule(dynamic, 1024)
+        for (int64_t i = 0; i < rows; i++)
+        {
+            tmp.clear();
+            for (int64_t k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+                tmp.push_back(std::make_pair(col[k], val[k]));
+            std::sort(tmp.begin(), tmp.end());
+            size_t u = 0;
+            for (size_t k = 0; k < tmp.size(); k++)
+            {
+                if (u > 0 && tmp[u - 1].first == tmp[k].first)
+                    tmp[u - 1].second += tmp[k].second;
+                else
+                    tmp[u++] = tmp[k];
+            }
+            for (size_t k = 0; k < u; k++)
+            {
+                col[row_ptr[i] + k] = tmp[k].first;
+                val[row_ptr[i] + k] = tmp[k].second;
+            }
+            unique[i] = u;
+        }
+    }
+
+    // Были повторы: строки сдвигаются к началу, val - на новое место за
+    // укороченным col, файл обрезается. Все записи идут по меньшим адресам,
+    // чем чтения, поэтому хватает одного прохода вперёд
+    int64_t nnz_unique = 0;
+    for (int64_t i = 0; i < rows; i++)
+        nnz_unique += unique[i];
+    if (nnz_unique != nnz)
+    {
+        double *new_val = reinterpret_cast<double *>(base + sizeof(int64_t) * (rows + 1) +
+                                                     CsrMatrix::col_bytes(nnz_unique));
+        int64_t pos = 0;
+        for (int64_t i = 0; i < rows; i++)
+        {
+            memmove(col + pos, col + row_ptr[i], sizeof(int32_t) * unique[i]);
+            pos += unique[i];
+        }
+        memset(col + nnz_unique, 0, CsrMatrix::col_bytes(nnz_unique) - sizeof(int32_t) * nnz_unique);
+        pos = 0;
+        for (int64_t i = 0; i < rows; i++)
+        {
+            memmove(new_val + pos, val + row_ptr[i], sizeof(double) * unique[i]);
+            pos += unique[i];
+        }
+        for (int64_t i = 0; i < rows; i++)
+            row_ptr[i + 1] = row_ptr[i] + unique[i];
+        h->nnz = nnz_unique;
+    }
+
+    munmap(ptr, size);
+    if (nnz_unique != nnz &&
+        truncate(tmp_path.c_str(), sizeof(CsrHeader) + sizeof(int64_t) * (rows + 1) +
+                                       CsrMatrix::col_bytes(nnz_unique) + sizeof(double) * nnz_unique) != 0)
+    {
+        perror(tmp_path.c_str());
+        return false;
+    }
+    if (rename(tmp_path.c_str(), cache_path) != 0)
+    {
+        perror(cache_path);
+        return false;
+    }
+    return true;
+}
+
+// Загружает матрицу: если рядом есть <path>.csr не старше самого файла,
+// он просто отображается, иначе сначала строится заново.
+inline bool load_matrix_market(const char *path, CsrMatrix &A)
+{
+    std::string cache = std::string(path) + ".csr";
+    struct stat src, dst;
+    if (stat(path, &src) != 0)
+    {
+        perror(path);
+        return false;
+    }
+    bool fresh = stat(cache.c_str(), &dst) == 0 && dst.st_mtime >= src.st_mtime;
+    if (fresh && A.map(cache.c_str()))
+        return true;
+
+    printf("Converting %s to %s\n", path, cache.c_str());
+    return mm_convert(path, cache.c_str()) && A.map(cache.c_str());
+}
+
+#endif
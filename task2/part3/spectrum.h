@@ -0,0 +1,74 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <cmath>
+#include <vector>
+#include <omp.h>
+
+#include "operator.h"
+
+// Степенной метод для оператора из operator.h: при shift == 0 ищет наибольшее
+// собственное число A, иначе - наибольшее собственное число shift * I - A.
+// Оператор симметричный, поэтому отношение Рэлея сходится с квадратом
+// отношения собственных чисел.
+template <typename Operator>
+static double power_iteration(Operator &A, double shift, int iters)
+{
+    int n = A.size();
+    std::vector<double> v(n), w(n);
+    double vw = 0.0, ww = 0.0, lambda = 0.0, scale = 0.0;
+
+    double norm = 0.0;
+    for (int i = 0; i < n; i++) {
+        v[i] = 1.0 + 0.5 * sin(i + 1.0);
+        norm += v[i] * v[i];
+    }
+    norm = sqrt(norm);
+    for (int i = 0; i < n; i++) {
+        v[i] /= norm;
+    }
+
+    #pragma omp parallel
+    {
+        for (int k = 0; k < iters; k++) {
+            A.prepare(v.data());
+
+            #pragma omp for reduction(+:vw, ww)
+            for (int i = 0; i < n; i++) {
+                double sum = A.row(i, v.data());
+                w[i] = (shift != 0.0) ? shift * v[i] - sum : sum;
+                vw += v[i] * w[i];
+                ww += w[i] * w[i];
+            }
+
+            #pragma omp single
+            {
+                lambda = vw;
+                scale = 1.0 / sqrt(ww);
+                vw = 0.0, ww = 0.0;
+            }
+
+            #pragma omp for
+            for (int i = 0; i < n; i++) {
+                v[i] = w[i] * scale;
+            }
+        }
+    }
+
+    return lambda;
+}
+
+// Границы спектра SPD-матрицы. Степенной метод даёт lambda_max с недостатком,
+// а lambda_min с избытком, поэтому интервал расширяется на 5% в обе стороны:
+// шаг 2 / (lambda_min + lambda_max) с заниженным lambda_max может разойтись.
+template <typename Operator>
+static void estimate_spectrum(Operator &A, int iters, double *lmin, double *lmax)
+{
+    *lmax = 1.05 * power_iteration(A, 0.0, iters);
+    *lmin = 0.95 * (*lmax - power_iteration(A, *lmax, iters));
+    if (*lmin <= 0.0) {
+        *lmin = 1e-6 * *lmax;
+    }
+}
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+
+// Привязка потоков к ядрам и размещение памяти по NUMA-узлам без libnuma:
+// топология читается из /sys, а mbind вызывается через syscall.
+//
+// NONE - потоки не привязаны, память размещает ядро ОС.
+// COMPACT - поток t на t-м ядре по порядку узлов: сначала заполняется узел 0.
+// SCATTER - потоки по очереди раскладываются по узлам: поток t на узле t % nodes.
+enum AffinityMode { AFFINITY_NONE, AFFINITY_COMPACT, AFFINITY_SCATTER };
+static constexpr const char *affinity_names[] = {"none", "compact", "scatter"};
+
+// Узлы без доступных процессу ядер пропускаются, поэтому индекс в node_cpus
+// не обязан совпадать с номером узла: для mbind нужен node_ids[k].
+struct Topology
+{
+    std::vector<std::vector<int>> node_cpus; // Доступные процессу ядра каждого узла
+    std::vector<int> node_ids;               // Номер узла в /sys для node_cpus[k]
+    std::vector<int> cpu_node;               // Номер узла каждого ядра, -1 если ядра нет
+};
+
+// Разбирает список вида "0-3,8-11"
+inline std::vector<int> parse_cpulist(const char *text)
+{
+    std::vector<int> cpus;
+    const char *p = text;
+    while (*p && *p != '\n') {
+        char *end;
+        long lo = strtol(p, &end, 10), hi = lo;
+        if (end == p)
+            break;
+        if (*end == '-')
+            hi = strtol(end + 1, &end, 10);
+        for (long c = lo; c <= hi; ++c)
+            cpus.push_back((int)c);
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return cpus;
+}
+
+inline Topology read_topology()
+{
+    Topology topo;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    // Номера узлов могут идти с пропусками (например, "0-1,4"), поэтому
+    // перебираются узлы из списка online, а не node0, node1, ... до первой дыры
+    char buf[4096];
+    std::vector<int> online;
+    FILE *file = fopen("/sys/devices/system/node/online", "r");
+    if (file) {
+        if (fgets(buf, sizeof(buf), file))
+            online = parse_cpulist(buf);
+        fclose(file);
+    }
+
+    for (int node : online) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        file = fopen(path, "r");
+        if (!file)
+            continue;
+        if (!fgets(buf, sizeof(buf), file))
+            buf[0] = '\0';
+        fclose(file);
+
+        std::vector<int> cpus;
+        for (int cpu : parse_cpulist(buf))
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+        if (!cpus.empty()) {
+            topo.node_cpus.push_back(cpus);
+            topo.node_ids.push_back(node);
+        }
+    }
+
+    // Без /sys (или без NUMA) считаем, что есть один узел со всеми доступными ядрами
+    if (topo.node_cpus.empty()) {
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+        topo.node_cpus.push_back(cpus);
+        topo.node_ids.push_back(0);
+    }
+
+    for (size_t k = 0; k < topo.node_cpus.size(); ++k)
+        for (int cpu : topo.node_cpus[k]) {
+            if (cpu >= (int)topo.cpu_node.size())
+                topo.cpu_node.resize(cpu + 1, -1);
+            topo.cpu_node[cpu] = topo.node_ids[k];
+        }
+    return topo;
+}
+
+// Ядро для потока t; при потоках больше, чем ядер, раскладка идёт по кругу
+inline int affinity_cpu(const Topology &topo, AffinityMode mode, int t)
+{
+    int nodes = (int)topo.node_cpus.size();
+    if (mode == AFFINITY_SCATTER) {
+        const std::vector<int> &cpus = topo.node_cpus[t % nodes];
+        return cpus[(t / nodes) % cpus.size()];
+    }
+    int total = 0;
+    for (int node = 0; node < nodes; ++node)
+        total += (int)topo.node_cpus[node].size();
+    t %= total;
+    for (int node = 0;; ++node) {
+        if (t < (int)topo.node_cpus[node].size())
+            return topo.node_cpus[node][t];
+        t -= (int)topo.node_cpus[node].size();
+    }
+}
+
+// Привязывает вызывающий поток к ядру cpu; cpu < 0 снимает привязку
+inline void pin_current_thread(const Topology &topo, int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (cpu >= 0) {
+        CPU_SET(cpu, &set);
+    } else {
+        for (const std::vector<int> &cpus : topo.node_cpus)
+            for (int c : cpus)
+                CPU_SET(c, &set);
+    }
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0)
+        fprintf(stderr, "pthread_setaffinity_np: %s\n", strerror(err));
+}
+
+// Номер узла, на котором сейчас выполняется поток
+inline int current_node(const Topology &topo)
+{
+    int cpu = sched_getcpu();
+    return (cpu >= 0 && cpu < (int)topo.cpu_node.size() && topo.cpu_node[cpu] >= 0) ? topo.cpu_node[cpu]
+                                                                                    : topo.node_ids[0];
+}
+
+// Размещает страницы, целиком лежащие в [ptr, ptr + bytes), на узле с номером
+// node (номер из /sys, не индекс в node_cpus). Вызывается до первого касания;
+// уже занятые страницы переносятся (MPOL_MF_MOVE).
+inline void bind_to_node(void *ptr, size_t bytes, int node)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t lo = ((uintptr_t)ptr + page - 1) / page * page;
+    uintptr_t hi = ((uintptr_t)ptr + bytes) / page * page;
+    if (hi <= lo)
+        return;
+    // Маска на сколько угодно узлов; maxnode на единицу больше числа бит, как в libnuma
+    const int bits = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> mask(node / bits + 1, 0);
+    mask[node / bits] = 1UL << (node % bits);
+    if (syscall(SYS_mbind, (void *)lo, hi - lo, MPOL_BIND, mask.data(), mask.size() * bits + 1, MPOL_MF_MOVE) != 0)
+        perror("mbind");
+}
+
+// Аллокатор для std::vector: память берётся через mmap и не трогается при
+// создании вектора (элементы не обнуляются), так что первое касание и mbind
+// происходят уже из потоков, владеющих своими блоками строк.
+template <typename T>
+struct NumaAllocator
+{
+    typedef T value_type;
+
+    NumaAllocator() {}
+    template <typename U>
+    NumaAllocator(const NumaAllocator<U> &) {}
+
+    T *allocate(size_t count)
+    {
+        void *ptr = mmap(nullptr, count * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+            throw std::bad_alloc();
+        return static_cast<T *>(ptr);
+    }
+
+    void deallocate(T *ptr, size_t count) { munmap(ptr, count * sizeof(T)); }
+
+    // Инициализация по умолчанию вместо обнуления
+    template <typename U>
+    void construct(U *ptr) { ::new ((void *)ptr) U; }
+    template <typename U, typename... Args>
+    void construct(U *ptr, Args &&...args) { ::new ((void *)ptr) U(std::forward<Args>(args)...); }
+};
+
+template <typename T, typename U>
+bool operator==(const NumaAllocator<T> &, const NumaAllocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator!=(const NumaAllocator<T> &, const NumaAllocator<U> &) { return false; }
+
+typedef std::vector<double, NumaAllocator<double>> numa_vector;
+
+#endif
@@ -4,8 +4,12 @@
 #include <fstream>
 #include <chrono>
 #include <functional>
+#include <cstring>
 
-void initialize_matrix(std::vector<double> &matrix, int start_idx, int end_idx, int n)
+#include "affinity.h"
+#include "thread_pool.h"
+
+void initialize_matrix(numa_vector &matrix, int start_idx, int end_idx, int n)
 {
     for (int i = start_idx; i < end_idx; ++i)
     {
@@ -16,7 +20,7 @@ void initialize_matrix(std::vector<double> &matrix, int start_idx, int end_idx,
     }
 }
 
-void initialize_vector(std::vector<double> &vector, int start_idx, int end_idx)
+void initialize_vector(numa_vector &vector, int start_idx, int end_idx)
 {
     for (int j = start_idx; j < end_idx; ++j)
     {
@@ -24,7 +28,7 @@ void initialize_vector(std::vector<double> &vector, int start_idx, int end_idx)
     }
 }
 
-void matrix_vector_multiplication(std::vector<double> &matrix, std::vector<double> &vector, std::vector<double> &result, int start_idx, int end_idx, int n)
+void matrix_vector_multiplication(numa_vector &matrix, numa_vector &vector, numa_vector &result, int start_idx, int end_idx, int n)
 {
     for (int i = start_idx; i < end_idx; ++i) {
         result[i] = 0.0;
@@ -33,50 +37,40 @@ void matrix_vector_multiplication(std::vector<double> &matrix, std::vector<doubl
     }
 }
 
-double run_threaded(int n, int num_threads) {
-    std::vector<double> matrix(n * n);
-    std::vector<double> vector(n);
-    std::vector<double> result(n);
-
-    {
-        std::vector<std::thread> threads;
-        int block = n / num_threads;
+// Привязывает каждый поток пула к ядру по раскладке mode (или снимает привязку)
+void set_affinity(ThreadPool &pool, const Topology &topo, AffinityMode mode) {
+    pool.parallel_for(pool.size(), 0, pool.size(), [&](int t, int) {
+        pin_current_thread(topo, (mode == AFFINITY_NONE) ? -1 : affinity_cpu(topo, mode, t));
+    });
+}
 
-        for (int t = 0; t < num_threads; ++t) {
-            int start_idx = t * block;
-            int end_idx = (t == num_threads - 1) ? n : start_idx + block;
-            threads.emplace_back(initialize_matrix, std::ref(matrix), start_idx, end_idx, n);
+// Все фазы идут через один и тот же пул: потоки не создаются заново ни между
+// фазами, ни между размерами и числами потоков. Векторы создаются без
+// обнуления, так что первым страницы блока строк касается его поток; при
+// привязке блок matrix и result ещё и явно размещается на узле этого потока.
+double run_threaded(ThreadPool &pool, const Topology &topo, AffinityMode mode, int n, int num_threads) {
+    numa_vector matrix((size_t)n * n);
+    numa_vector vector(n);
+    numa_vector result(n);
+
+    pool.parallel_for(num_threads, 0, n, [&](int start_idx, int end_idx) {
+        if (mode != AFFINITY_NONE) {
+            int node = current_node(topo);
+            bind_to_node(&matrix[(size_t)start_idx * n], sizeof(double) * (end_idx - start_idx) * n, node);
+            bind_to_node(&result[start_idx], sizeof(double) * (end_idx - start_idx), node);
         }
-        for (auto &t : threads) t.join();
-    }
+        initialize_matrix(matrix, start_idx, end_idx, n);
+    });
 
-    {
-        std::vector<std::thread> threads;
-        int block = n / num_threads;
-
-        for (int t = 0; t < num_threads; ++t) {
-            int start_idx = t * block;
-            int end_idx = (t == num_threads - 1) ? n : start_idx + block;
-            threads.emplace_back(initialize_vector, std::ref(vector), start_idx, end_idx);
-        }
-        for (auto &t : threads) t.join();
-    }
+    pool.parallel_for(num_threads, 0, n, [&](int start_idx, int end_idx) {
+        initialize_vector(vector, start_idx, end_idx);
+    });
 
     auto start = std::chrono::high_resolution_clock::now();
 
-    {
-        std::vector<std::thread> threads;
-        int block = n / num_threads;
-
-        for (int t = 0; t < num_threads; ++t) {
-            int start_idx = t * block;
-            int end_idx = (t == num_threads - 1) ? n : start_idx + block;
-            threads.emplace_back(matrix_vector_multiplication,
-                                 std::ref(matrix), std::ref(vector), std::ref(result),
-                                 start_idx, end_idx, n);
-        }
-        for (auto &t : threads) t.join();
-    }
+    pool.parallel_for(num_threads, 0, n, [&](int start_idx, int end_idx) {
+        matrix_vector_multiplication(matrix, vector, result, start_idx, end_idx, n);
+    });
 
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> diff = end - start;
@@ -102,25 +96,52 @@ void writeCSV(const char *filename, double results[2][16]) {
     file.close();
 }
 
-int main() {
+// Использование: main [compact|scatter|compare]; compare прогоняет все три
+// раскладки и пишет results_thread.csv, results_thread_compact.csv и
+// results_thread_scatter.csv
+int main(int argc, char **argv) {
     int thread_counts[] = {2, 4, 7, 8, 16, 20, 40};
     double results[2][16] = {0};
-    const char *filename = "results_thread.csv";
-
-    for (int test = 0; test < 2; ++test) {
-        int size = (test == 0) ? 20000 : 40000;
-        double time_serial = run_threaded(size, 1);
-        results[test][0] = time_serial;
-
-        for (int i = 0; i < 7; ++i) {
-            int threads = thread_counts[i];
-            double time_parallel = run_threaded(size, threads);
-            results[test][2 * i + 1] = time_parallel;
-            results[test][2 * i + 2] = time_serial / time_parallel;
+    AffinityMode first = AFFINITY_NONE, last = AFFINITY_NONE;
+    if (argc > 1) {
+        if (strcmp(argv[1], "compact") == 0) {
+            first = last = AFFINITY_COMPACT;
+        } else if (strcmp(argv[1], "scatter") == 0) {
+            first = last = AFFINITY_SCATTER;
+        } else if (strcmp(argv[1], "compare") == 0) {
+            last = AFFINITY_SCATTER;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [compact|scatter|compare]\n";
+            return 1;
         }
     }
 
-    writeCSV(filename, results);
-    std::cout << "Done. Results written to " << filename << std::endl;
+    Topology topo = read_topology();
+    std::cout << "NUMA nodes: " << topo.node_cpus.size() << std::endl;
+    ThreadPool pool(40);
+
+    for (int m = first; m <= last; ++m) {
+        AffinityMode mode = (AffinityMode)m;
+        set_affinity(pool, topo, mode);
+
+        for (int test = 0; test < 2; ++test) {
+            int size = (test == 0) ? 20000 : 40000;
+            double time_serial = run_threaded(pool, topo, mode, size, 1);
+            results[test][0] = time_serial;
+
+            for (int i = 0; i < 7; ++i) {
+                int threads = thread_counts[i];
+                double time_parallel = run_threaded(pool, topo, mode, size, threads);
+                results[test][2 * i + 1] = time_parallel;
+                results[test][2 * i + 2] = time_serial / time_parallel;
+            }
+        }
+
+        char filename[64];
+        snprintf(filename, sizeof(filename), "results_thread%s%s.csv",
+                 (mode == AFFINITY_NONE) ? "" : "_", (mode == AFFINITY_NONE) ? "" : affinity_names[mode]);
+        writeCSV(filename, results);
+        std::cout << "Done. Results written to " << filename << std::endl;
+    }
     return 0;
 }
@@ -1,17 +1,21 @@
 #include <iostream>
 #include <thread>
 #include <queue>
-#include <unordered_map>
 #include <functional>
-#include <future>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <fstream>
 #include <random>
 #include <cmath>
 #include <iomanip>
 #include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "task_server.h"
 
 template<typename T>
 T fun_sin(T arg) {
@@ -28,106 +32,26 @@ T fun_pow(T x, T y) {
     return std::pow(x, y);
 }
 
-template<typename T>
-class TaskServer {
-public:
-    using Task = std::function<T()>;
-
-    TaskServer() : running(false), task_id(0) {}
-
-    void start() {
-        running = true;
-        worker = std::thread(&TaskServer::process_tasks, this);
-    }
-
-    void stop() {
-        {
-            std::lock_guard<std::mutex> lock(mutex_queue);
-            running = false;
-        }
-        cv.notify_all();
-        if (worker.joinable()) worker.join();
-    }
-
-    size_t add_task(Task task) {
-        std::lock_guard<std::mutex> lock(mutex_queue);
-        size_t id = task_id++;
-        std::promise<T> prom;
-        results[id] = prom.get_future();
-        tasks.push({id, std::move(task), std::move(prom)});
-        cv.notify_one();
-        return id;
-    }
-
-    T request_result(size_t id) {
-        std::future<T>& fut = results.at(id);
-        return fut.get();
-    }
-
-private:
-    struct TaskItem {
-        size_t id;
-        Task task;
-        std::promise<T> prom;
-    };
-
-    void process_tasks() {
-        while (true) {
-            TaskItem item;
-            {
-                std::unique_lock<std::mutex> lock(mutex_queue);
-                cv.wait(lock, [&]() { return !tasks.empty() || !running; });
-
-                if (!running && tasks.empty()) break;
-                if (tasks.empty()) continue;
-
-                item = std::move(tasks.front());
-                
-                tasks.pop();
-            }
-
-            try {
-                T result = item.task();  
-                item.prom.set_value(result);
-            } catch (...) {
-                item.prom.set_exception(std::current_exception());
-            }
-        }
-    }
-
-    std::atomic<bool> running;
-    std::atomic<size_t> task_id;
-    std::thread worker;
-
-    std::queue<TaskItem> tasks;
-    std::unordered_map<size_t, std::future<T>> results;
-    std::mutex mutex_queue;
-    std::condition_variable cv;
-};
-
 void client(TaskServer<double>& server, int task_type, int N, const std::string& filename) {
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_real_distribution<> dis(0.1, 10.0);
 
-    std::vector<size_t> ids;
+    std::vector<TaskServer<double>::Task> tasks;
     std::vector<std::tuple<std::string, double, double>> args;
 
     for (int i = 0; i < N; ++i) {
         if (task_type == 1) {
             double val = dis(gen);
-            size_t id = server.add_task([val]() { return fun_sin(val); });
-            ids.push_back(id);
+            tasks.emplace_back([val]() { return fun_sin(val); });
             args.emplace_back("sin", val, 0.0);
         } else if (task_type == 2) {
             double val = dis(gen);
-            size_t id = server.add_task([val]() { return fun_sqrt(val); });
-            ids.push_back(id);
+            tasks.emplace_back([val]() { return fun_sqrt(val); });
             args.emplace_back("sqrt", val, 0.0);
         } else if (task_type == 3) {
             double base = dis(gen), exp = dis(gen);
-            size_t id = server.add_task([base, exp]() { return fun_pow(base, exp); });
-            ids.push_back(id);
+            tasks.emplace_back([base, exp]() { return fun_pow(base, exp); });
             args.emplace_back("pow", base, exp);
         }
     }
@@ -135,35 +59,40 @@ void client(TaskServer<double>& server, int task_type, int N, const std::string&
     std::ofstream fout(filename, std::ios::app);
     fout << std::fixed << std::setprecision(6);
 
-    
-    for (size_t i = 0; i < ids.size(); ++i) {
-        double result = server.request_result(ids[i]);
-        const auto& [operation, arg1, arg2] = args[i];
-        fout << operation << " " << arg1;
-        if (operation == "pow") {
-            fout << " " << arg2;
+    // Задачи идут пачками по chunk, id внутри пачки подряд; результаты пачки
+    // забираются до отправки следующей, так что невостребованных результатов
+    // у клиента не больше chunk и при любом N он не упирается в result_capacity
+    const size_t chunk = std::min<size_t>(4096, server.result_capacity());
+    for (size_t begin = 0; begin < tasks.size(); begin += chunk) {
+        size_t end = std::min(tasks.size(), begin + chunk);
+        size_t first_id = server.add_tasks(tasks.begin() + begin, tasks.begin() + end).first;
+
+        for (size_t i = begin; i < end; ++i) {
+            double result = server.request_result(first_id + (i - begin));
+            const auto& [operation, arg1, arg2] = args[i];
+            fout << operation << " " << arg1;
+            if (operation == "pow") {
+                fout << " " << arg2;
+            }
+            fout << " = " << result << "\n";
         }
-        fout << " = " << result << "\n";
     }
 }
 
-int main() {
-
+// Три клиента по N задач; возвращает время от запуска сервера до его остановки
+double run_benchmark(Scheduling scheduling, size_t num_workers, int N) {
     using clock = std::chrono::high_resolution_clock;
 
-    TaskServer<double> server;
+    TaskServer<double> server(num_workers, scheduling);
 
-    auto start = clock::now();
-
-    server.start();
-
-    const int N = 10000;
-
-    
     std::ofstream("sin_output.txt", std::ios::trunc).close();
     std::ofstream("sqrt_output.txt", std::ios::trunc).close();
     std::ofstream("pow_output.txt", std::ios::trunc).close();
 
+    auto start = clock::now();
+
+    server.start();
+
     std::thread client1(client, std::ref(server), 1, N, "sin_output.txt");
     std::thread client2(client, std::ref(server), 2, N, "sqrt_output.txt");
     std::thread client3(client, std::ref(server), 3, N, "pow_output.txt");
@@ -177,7 +106,177 @@ int main() {
     auto end = clock::now();
 
     std::chrono::duration<double> elapsed = end - start;
+    return elapsed.count();
+}
+
+// Дорогая задача pow: cost возведений в степень вместо одного
+double heavy_pow(double base, double exp, int cost) {
+    double sum = 0.0;
+    for (int k = 0; k < cost; ++k) {
+        sum += fun_pow(base, exp + 1e-3 * k);
+    }
+    return sum;
+}
+
+// Неравномерная нагрузка: клиент чередует дешёвые задачи sqrt и дорогие pow,
+// а каждая задача pow ещё и добавляет fanout таких же задач изнутри сервера.
+// При раздаче по кругу и чётном числе рабочих все pow от клиента попадают к
+// рабочим с нечётными номерами, так что без кражи половина простаивала бы.
+// latencies - время каждой задачи от add_task до конца её выполнения;
+// возвращает время от первой add_task до остановки сервера.
+double run_skewed(Scheduling scheduling, size_t num_workers, int N, std::vector<double>& latencies) {
+    using clock = std::chrono::steady_clock;
+    const int pow_cost = 200;
+    const int fanout = 4;
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> dis(0.1, 10.0);
+
+    latencies.assign(N + (size_t)(N / 2) * fanout, 0.0);
+    std::atomic<size_t> next_slot(N);
+    auto finish = [&latencies](size_t slot, clock::time_point submitted) {
+        latencies[slot] = std::chrono::duration<double>(clock::now() - submitted).count();
+    };
+
+    TaskServer<double> server(num_workers, scheduling);
+    server.start();
+
+    auto start = clock::now();
+    for (int i = 0; i < N; ++i) {
+        auto submitted = clock::now();
+        if (i % 2 == 0) {
+            double val = dis(gen);
+            server.discard_result(server.add_task([=, &finish]() {
+                double result = fun_sqrt(val);
+                finish(i, submitted);
+                return result;
+            }));
+        } else {
+            double base = dis(gen), exp = dis(gen);
+            server.discard_result(server.add_task([=, &server, &finish, &next_slot]() {
+                for (int c = 0; c < fanout; ++c) {
+                    size_t slot = next_slot++;
+                    auto child_submitted = clock::now();
+                    server.discard_result(server.add_task([=, &finish]() {
+                        double result = heavy_pow(base, exp + c, pow_cost);
+                        finish(slot, child_submitted);
+                        return result;
+                    }));
+                }
+                double result = heavy_pow(base, exp, pow_cost);
+                finish(i, submitted);
+                return result;
+            }));
+        }
+    }
+    server.stop();
+    auto end = clock::now();
+
+    std::chrono::duration<double> elapsed = end - start;
+    return elapsed.count();
+}
 
+// Стоимость постановки в очередь: total пустых задач пачками по batch
+// (batch = 0 - по одной через add_task). Замеряются только вызовы
+// add_task/add_tasks; результаты потом забираются, чтобы не упереться в
+// result_capacity. Возвращает наносекунды на задачу.
+double run_submission(size_t num_workers, size_t batch, size_t total) {
+    using clock = std::chrono::steady_clock;
+
+    TaskServer<double> server(num_workers);
+    server.start();
+
+    std::vector<TaskServer<double>::Task> tasks;
+    std::chrono::duration<double> elapsed(0);
+    for (size_t done = 0; done < total;) {
+        size_t count = std::min(std::max<size_t>(batch, 1), total - done);
+        tasks.clear();
+        for (size_t k = 0; k < count; ++k) {
+            double val = (double)(done + k);
+            tasks.emplace_back([val]() { return val; });
+        }
+        auto start = clock::now();
+        if (batch == 0) {
+            server.add_task(std::move(tasks[0]));
+        } else {
+            server.add_tasks(tasks.begin(), tasks.end());
+        }
+        elapsed += clock::now() - start;
+        done += count;
+    }
+
+    double sum = 0.0;
+    for (size_t id = 0; id < total; ++id) {
+        sum += server.request_result(id);
+    }
+    server.stop();
+    if (sum != (double)total * (total - 1) / 2) {
+        std::cerr << "Wrong results for batch " << batch << std::endl;
+    }
+    return 1e9 * elapsed.count() / total;
+}
+
+int main() {
+
+    const int N = 10000;
+    size_t hw = std::max(1u, std::thread::hardware_concurrency());
+
+    // Пропускная способность при разном числе рабочих потоков сервера
+    std::vector<size_t> worker_counts = {1, 2, 4, 8};
+    if (std::find(worker_counts.begin(), worker_counts.end(), hw) == worker_counts.end()) {
+        worker_counts.push_back(hw);
+    }
+    std::sort(worker_counts.begin(), worker_counts.end());
+
+    std::ofstream csv("results_server.csv", std::ios::trunc);
+    csv << "Scheduler,Workers,Time,TasksPerSec,Speedup\n";
+    std::ofstream csv_skewed("results_skewed.csv", std::ios::trunc);
+    csv_skewed << "Scheduler,Workers,Tasks,Time,TasksPerSec,Speedup,LatencyP50,LatencyP99,LatencyMax\n";
+
+    for (Scheduling scheduling : {SCHED_CENTRAL, SCHED_STEALING}) {
+        const char* name = scheduling_names[scheduling];
+
+        double time_single = 0.0;
+        for (size_t workers : worker_counts) {
+            double elapsed = run_benchmark(scheduling, workers, N);
+            if (workers == 1) time_single = elapsed;
+            double throughput = 3.0 * N / elapsed;
+            std::cout << name << ", workers: " << workers << ", time: " << elapsed << " s, "
+                      << throughput << " tasks/s" << std::endl;
+            csv << name << "," << workers << "," << elapsed << "," << throughput << "," << time_single / elapsed << "\n";
+        }
+
+        // Хвост задержек при неравномерной нагрузке; задержки в миллисекундах
+        time_single = 0.0;
+        for (size_t workers : worker_counts) {
+            std::vector<double> latencies;
+            double elapsed = run_skewed(scheduling, workers, N, latencies);
+            if (workers == 1) time_single = elapsed;
+            std::sort(latencies.begin(), latencies.end());
+            double p50 = 1e3 * latencies[latencies.size() / 2];
+            double p99 = 1e3 * latencies[(size_t)(0.99 * (latencies.size() - 1))];
+            double max = 1e3 * latencies.back();
+            double throughput = latencies.size() / elapsed;
+            std::cout << name << ", skewed, workers: " << workers << ", time: " << elapsed << " s, "
+                      << throughput << " tasks/s, p50: " << p50 << " ms, p99: " << p99 << " ms" << std::endl;
+            csv_skewed << name << "," << workers << "," << latencies.size() << "," << elapsed << "," << throughput << ","
+                       << time_single / elapsed << "," << p50 << "," << p99 << "," << max << "\n";
+        }
+    }
+
+    // Стоимость постановки задачи в зависимости от размера пачки
+    std::ofstream csv_batch("results_batch.csv", std::ios::trunc);
+    csv_batch << "Batch,Tasks,NsPerTask\n";
+    const size_t submit_total = 1 << 15;
+    for (size_t batch = 0; batch <= 4096; batch = (batch == 0) ? 1 : 2 * batch) {
+        double ns = run_submission(hw, batch, submit_total);
+        std::cout << "Batch: " << (batch == 0 ? std::string("add_task") : std::to_string(batch)) << ", "
+                  << ns << " ns/task" << std::endl;
+        csv_batch << (batch == 0 ? std::string("add_task") : std::to_string(batch)) << "," << submit_total << ","
+                  << ns << "\n";
+    }
+
+    // Файлы остаются от последнего прогона, их проверяет check
     auto count_lines = [](const std::string& filename) {
         std::ifstream fin(filename);
         return std::count(std::istreambuf_iterator<char>(fin),
@@ -188,8 +287,5 @@ int main() {
     std::cout << "sqrt_output.txt lines: " << count_lines("sqrt_output.txt") << std::endl;
     std::cout << "pow_output.txt lines: " << count_lines("pow_output.txt") << std::endl;
 
-    std::cout << "Total execution time: " << elapsed.count() << " seconds\n";
-
-
     return 0;
 }
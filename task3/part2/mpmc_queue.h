@@ -0,0 +1,184 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Наименьшая степень двойки, не меньшая n (для n = 0 - единица)
+inline size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// Ограниченная очередь многие-производители/многие-потребители без блокировок
+// (схема Дмитрия Вьюкова). Ячейки кольца несут счётчик sequence: ячейка pos
+// свободна для записи, когда sequence == pos, и готова к чтению, когда
+// sequence == pos + 1. Производители и потребители захватывают позиции через
+// CAS на своих счётчиках и дальше работают каждый со своей ячейкой.
+// Ёмкость округляется вверх до степени двойки, не меньше 2: при одной ячейке
+// счётчик свободной ячейки совпадал бы со счётчиком заполненной.
+template <typename T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(size_t capacity) : mask(round_up_pow2(capacity < 2 ? 2 : capacity) - 1), cells(mask + 1) {
+        for (size_t i = 0; i <= mask; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos.store(0, std::memory_order_relaxed);
+        dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    ~MpmcQueue() {
+        T value;
+        while (try_pop(value)) {
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // false, если очередь заполнена
+    bool try_push(T&& value) {
+        Cell* cell;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->storage) T(std::move(value));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Кладёт подряд до count элементов из values одним CAS на enqueue_pos;
+    // возвращает, сколько положено (0 - очередь заполнена). Элементы
+    // перемещаются из values
+    size_t try_push_bulk(T* values, size_t count) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        size_t n;
+        while (true) {
+            // Свободные для этого круга ячейки подряд от pos; чужой производитель
+            // занять их не может, пока не сдвинет enqueue_pos
+            n = 0;
+            while (n < count && cells[(pos + n) & mask].sequence.load(std::memory_order_acquire) == pos + n) {
+                ++n;
+            }
+            if (n > 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) break;
+                continue;
+            }
+            size_t seq = cells[pos & mask].sequence.load(std::memory_order_acquire);
+            if ((intptr_t)seq - (intptr_t)pos < 0) return 0;
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            Cell& cell = cells[(pos + i) & mask];
+            new (cell.storage) T(std::move(values[i]));
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return n;
+    }
+
+    // false, если очередь пуста
+    bool try_pop(T& value) {
+        Cell* cell;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        T* item = reinterpret_cast<T*>(cell->storage);
+        value = std::move(*item);
+        item->~T();
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    // Счётчики на разных кэш-линиях, чтобы производители и потребители не мешали друг другу
+    const size_t mask;
+    std::vector<Cell> cells;
+    alignas(64) std::atomic<size_t> enqueue_pos;
+    alignas(64) std::atomic<size_t> dequeue_pos;
+};
+
+// Парковка простаивающих потоков на futex (eventcount). Потребитель:
+//   key = prepare_wait(); перепроверить очередь; wait(key) или cancel_wait().
+// Производитель после push вызывает notify_one() (или notify(count)):
+// системный вызов делается, только если кто-то действительно собирается
+// спать. Счётчик ожидающих и эпоха упорядочены seq_cst, поэтому либо
+// производитель увидит ожидающего, либо ожидающий при перепроверке увидит
+// задачу.
+class Parker {
+public:
+    Parker() : epoch(0), waiters(0) {}
+
+    uint32_t prepare_wait() {
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        return epoch.load(std::memory_order_seq_cst);
+    }
+
+    void cancel_wait() {
+        waiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    // Спит, пока эпоха равна key; ложные пробуждения допустимы
+    void wait(uint32_t key) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch), FUTEX_WAIT_PRIVATE, key, nullptr, nullptr, 0);
+        waiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    // Будит не больше count спящих
+    void notify(int count) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_seq_cst) > 0) {
+            epoch.fetch_add(1, std::memory_order_seq_cst);
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+        }
+    }
+
+    void notify_one() {
+        notify(1);
+    }
+
+    void notify_all() {
+        notify(INT_MAX);
+    }
+
+private:
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a plain 32-bit word");
+    std::atomic<uint32_t> epoch;
+    std::atomic<int> waiters;
+};
+
+#endif
@@ -0,0 +1,178 @@
+#include <iostream>
+#include <thread>
+#include <queue>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "mpmc_queue.h"
+
+// Микробенчмарк очереди задач сервера: producers потоков кладут по N задач
+// std::function<double()>, consumers потоков их выполняют. Сравниваются
+// прежняя схема (std::queue + mutex + condition_variable, notify_one на каждую
+// задачу) и MpmcQueue + Parker из TaskServer.
+
+using Task = std::function<double()>;
+
+// Прежняя очередь TaskServer
+class MutexQueue {
+public:
+    void push(Task task) {
+        std::lock_guard<std::mutex> lock(mutex_queue);
+        tasks.push(std::move(task));
+        cv.notify_one();
+    }
+
+    // false, когда очередь закрыта и пуста
+    bool pop(Task& task) {
+        std::unique_lock<std::mutex> lock(mutex_queue);
+        cv.wait(lock, [&]() { return !tasks.empty() || closed; });
+        if (tasks.empty()) return false;
+        task = std::move(tasks.front());
+        tasks.pop();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_queue);
+            closed = true;
+        }
+        cv.notify_all();
+    }
+
+private:
+    std::queue<Task> tasks;
+    std::mutex mutex_queue;
+    std::condition_variable cv;
+    bool closed = false;
+};
+
+// Очередь без блокировок с парковкой - как в TaskServer::process_tasks
+class LockFreeQueue {
+public:
+    LockFreeQueue() : tasks(1 << 16), closed(false) {}
+
+    void push(Task task) {
+        while (!tasks.try_push(std::move(task))) {
+            std::this_thread::yield();
+        }
+        parker.notify_one();
+    }
+
+    bool pop(Task& task) {
+        while (true) {
+            for (int spin = 0; spin < 64; ++spin) {
+                if (tasks.try_pop(task)) return true;
+            }
+            uint32_t key = parker.prepare_wait();
+            if (tasks.try_pop(task)) {
+                parker.cancel_wait();
+                return true;
+            }
+            if (closed.load()) {
+                parker.cancel_wait();
+                return tasks.try_pop(task);
+            }
+            parker.wait(key);
+        }
+    }
+
+    // Вызывается после того, как все производители закончили
+    void close() {
+        closed = true;
+        parker.notify_all();
+    }
+
+private:
+    MpmcQueue<Task> tasks;
+    Parker parker;
+    std::atomic<bool> closed;
+};
+
+template <typename Queue>
+double run(int producers, int consumers, int N, double* checksum, long* executed) {
+    using clock = std::chrono::high_resolution_clock;
+    Queue queue;
+    std::vector<double> sums(consumers, 0.0);
+    std::vector<long> counts(consumers, 0);
+    std::vector<std::thread> threads;
+
+    auto start = clock::now();
+
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&, c]() {
+            Task task;
+            double sum = 0.0;
+            long count = 0;
+            while (queue.pop(task)) {
+                sum += task();
+                count++;
+            }
+            sums[c] = sum;
+            counts[c] = count;
+        });
+    }
+
+    std::vector<std::thread> clients;
+    for (int p = 0; p < producers; ++p) {
+        clients.emplace_back([&, p]() {
+            for (int i = 0; i < N; ++i) {
+                double val = 0.1 + 1e-6 * i + p;
+                queue.push([val]() { return std::sin(val); });
+            }
+        });
+    }
+    for (auto& t : clients) t.join();
+    queue.close();
+    for (auto& t : threads) t.join();
+
+    auto end = clock::now();
+
+    *checksum = 0.0;
+    *executed = 0;
+    for (int c = 0; c < consumers; ++c) {
+        *checksum += sums[c];
+        *executed += counts[c];
+    }
+    std::chrono::duration<double> elapsed = end - start;
+    return elapsed.count();
+}
+
+int main() {
+    const int producers = 3;
+    const int N = 200000;
+    std::vector<int> consumer_counts = {1, 2, 4, 8};
+
+    // Эталонная сумма и число задач: ничего не должно ни теряться, ни выполняться дважды
+    double expected = 0.0;
+    for (int p = 0; p < producers; ++p)
+        for (int i = 0; i < N; ++i)
+            expected += std::sin(0.1 + 1e-6 * i + p);
+
+    std::ofstream csv("results_queue.csv", std::ios::trunc);
+    csv << "Queue,Producers,Consumers,Time,TasksPerSec,Verified\n";
+
+    for (int consumers : consumer_counts) {
+        for (int q = 0; q < 2; ++q) {
+            double checksum;
+            long executed;
+            double elapsed = (q == 0) ? run<MutexQueue>(producers, consumers, N, &checksum, &executed)
+                                      : run<LockFreeQueue>(producers, consumers, N, &checksum, &executed);
+            const char* name = (q == 0) ? "mutex" : "lock-free";
+            bool ok = executed == (long)producers * N && std::fabs(checksum - expected) < 1e-9 * std::fabs(expected);
+            double throughput = producers * (double)N / elapsed;
+            std::cout << name << ", consumers: " << consumers << ", " << throughput << " tasks/s"
+                      << (ok ? "" : " WRONG CHECKSUM") << std::endl;
+            csv << name << "," << producers << "," << consumers << "," << elapsed << "," << throughput << ","
+                << (ok ? 1 : 0) << "\n";
+        }
+    }
+
+    return 0;
+}
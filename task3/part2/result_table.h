@@ -0,0 +1,202 @@
+#ifndef RESULT_TABLE_H
+#define RESULT_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "mpmc_queue.h"
+
+// Результаты задач в кольце фиксированного размера: задача id живёт в ячейке
+// id % capacity. Слово state ячейки хранит id и состояние (id << 2 | tag):
+//   FREE    - ячейка свободна для задачи id;
+//   PENDING - задача id зарегистрирована, результата ещё нет;
+//   READY   - результат (значение или исключение) записан;
+//   CLAIMED - результат забирает клиент или он никому не нужен (discard).
+// Забранный результат освобождает ячейку для id + capacity, так что память не
+// растёт, сколько бы задач ни прошло. Поиск - одно атомарное чтение, без
+// замков. id выдаёт сама таблица (try_open), и только если ячейки новых id
+// свободны: одновременно невостребованных результатов (ещё не выполненных
+// задач и результатов, которые никто не забрал) не больше capacity. Когда
+// таблица полна, try_open ничего не ждёт и возвращает false - ждать или
+// отказывать, решает вызывающий. Ёмкость округляется вверх до степени двойки.
+template <typename T>
+class ResultTable {
+public:
+    explicit ResultTable(size_t capacity) : mask(round_up_pow2(capacity) - 1), slots(mask + 1), next_id(0) {
+        for (size_t i = 0; i <= mask; ++i) {
+            slots[i].state.store(make_state(i, FREE), std::memory_order_relaxed);
+        }
+    }
+
+    ~ResultTable() {
+        for (Slot& slot : slots) {
+            if ((slot.state.load(std::memory_order_relaxed) & tag_mask) == READY && !slot.error) {
+                value_of(slot)->~T();
+            }
+        }
+    }
+
+    ResultTable(const ResultTable&) = delete;
+    ResultTable& operator=(const ResultTable&) = delete;
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    // Сколько id выдано: все id меньше этого числа зарегистрированы
+    size_t opened() const {
+        return next_id.load(std::memory_order_acquire);
+    }
+
+    // Выдаёт count идущих подряд id и регистрирует их задачи; first_id - первый.
+    // false, если ячейка хотя бы одного из них ещё занята (count > capacity -
+    // всегда false). Ячейка FREE(id) меняется только владельцем id, а id
+    // становятся чьими-то только через CAS на next_id, поэтому проверенные до
+    // успешного CAS ячейки так и остаются свободными
+    bool try_open(size_t count, size_t* first_id) {
+        size_t id = next_id.load(std::memory_order_acquire);
+        while (true) {
+            size_t k = 0;
+            while (k < count && slot_of(id + k).state.load(std::memory_order_acquire) == make_state(id + k, FREE)) {
+                ++k;
+            }
+            if (k < count) {
+                // Ячейка занята либо старым результатом, либо уже новым id, который
+                // успел выдать кто-то другой; во втором случае пробуем дальше
+                size_t now = next_id.load(std::memory_order_acquire);
+                if (now == id) return false;
+                id = now;
+                continue;
+            }
+            if (next_id.compare_exchange_weak(id, id + count, std::memory_order_acq_rel)) break;
+        }
+        for (size_t k = 0; k < count; ++k) {
+            slot_of(id + k).state.store(make_state(id + k, PENDING), std::memory_order_relaxed);
+        }
+        *first_id = id;
+        return true;
+    }
+
+    void set_value(size_t id, T&& value) {
+        Slot& slot = slot_of(id);
+        new (slot.storage) T(std::move(value));
+        publish(slot, id);
+    }
+
+    void set_exception(size_t id, std::exception_ptr error) {
+        Slot& slot = slot_of(id);
+        slot.error = std::move(error);
+        publish(slot, id);
+    }
+
+    // Ждёт результат задачи id, забирает его и освобождает ячейку. Повторный
+    // запрос того же id (или запрос отброшенного) - std::logic_error
+    T take(size_t id) {
+        Slot& slot = slot_of(id);
+        for (int spin = 0; !try_claim(slot, id); ++spin) {
+            if (spin < spin_limit) continue;
+            uint32_t key = parker.prepare_wait();
+            if (try_claim(slot, id)) {
+                parker.cancel_wait();
+                break;
+            }
+            parker.wait(key);
+        }
+
+        if (slot.error) {
+            std::exception_ptr error = std::move(slot.error);
+            slot.error = nullptr;
+            release(slot, id);
+            std::rethrow_exception(error);
+        }
+        T* item = value_of(slot);
+        T value = std::move(*item);
+        item->~T();
+        release(slot, id);
+        return value;
+    }
+
+    // Результат задачи id не понадобится: ячейка освобождается сразу, если
+    // результат уже есть, или после выполнения задачи
+    void discard(size_t id) {
+        Slot& slot = slot_of(id);
+        uint64_t pending = make_state(id, PENDING);
+        if (slot.state.compare_exchange_strong(pending, make_state(id, CLAIMED), std::memory_order_acq_rel)) {
+            return;
+        }
+        uint64_t ready = make_state(id, READY);
+        if (slot.state.compare_exchange_strong(ready, make_state(id, CLAIMED), std::memory_order_acquire)) {
+            if (slot.error) {
+                slot.error = nullptr;
+            } else {
+                value_of(slot)->~T();
+            }
+            release(slot, id);
+        }
+    }
+
+private:
+    enum Tag : uint64_t { FREE = 0, PENDING = 1, READY = 2, CLAIMED = 3 };
+    static const uint64_t tag_mask = 3;
+    static const int spin_limit = 64;
+
+    struct Slot {
+        std::atomic<uint64_t> state;
+        std::exception_ptr error;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static uint64_t make_state(size_t id, Tag tag) {
+        return (uint64_t)id << 2 | tag;
+    }
+
+    Slot& slot_of(size_t id) {
+        return slots[id & mask];
+    }
+
+    static T* value_of(Slot& slot) {
+        return reinterpret_cast<T*>(slot.storage);
+    }
+
+    // Результат записан исполнителем; если клиент уже отказался от него,
+    // исполнитель сам освобождает ячейку
+    void publish(Slot& slot, size_t id) {
+        uint64_t pending = make_state(id, PENDING);
+        if (slot.state.compare_exchange_strong(pending, make_state(id, READY), std::memory_order_release)) {
+            parker.notify_all();
+            return;
+        }
+        if (slot.error) {
+            slot.error = nullptr;
+        } else {
+            value_of(slot)->~T();
+        }
+        release(slot, id);
+    }
+
+    bool try_claim(Slot& slot, size_t id) {
+        uint64_t state = slot.state.load(std::memory_order_acquire);
+        if ((state >> 2) > id || state == make_state(id, CLAIMED)) {
+            throw std::logic_error("ResultTable: result already taken or discarded");
+        }
+        return state == make_state(id, READY) &&
+               slot.state.compare_exchange_strong(state, make_state(id, CLAIMED), std::memory_order_acquire);
+    }
+
+    void release(Slot& slot, size_t id) {
+        slot.state.store(make_state(id + mask + 1, FREE), std::memory_order_release);
+    }
+
+    const size_t mask;
+    std::vector<Slot> slots;
+    alignas(64) std::atomic<size_t> next_id;
+    Parker parker;  // Клиенты, ждущие результат
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "task_server.h"
+
+// Проверки TaskServer, которые раньше зависали. Каждая проверка печатает
+// ok или FAIL; зависание ловит сторожевой поток, который через timeout
+// секунд завершает процесс с кодом 1.
+
+static int failures = 0;
+
+void report(const std::string& name, bool ok) {
+    std::cout << name << ": " << (ok ? "ok" : "FAIL") << std::endl;
+    if (!ok) ++failures;
+}
+
+void start_watchdog(int timeout) {
+    std::thread([timeout]() {
+        std::this_thread::sleep_for(std::chrono::seconds(timeout));
+        std::cout << "TIMEOUT: a test is hanging" << std::endl;
+        std::_Exit(1);
+    }).detach();
+}
+
+// Ёмкость 4: задача 0 занимает свою ячейку, пока выполняется, а её четвёртый
+// потомок получил бы id 4 с той же ячейкой. Рабочий не должен ждать её вечно -
+// add_task бросает std::length_error, и задача завершается с этим исключением
+void test_worker_submission_when_full(Scheduling scheduling) {
+    TaskServer<double> server(2, scheduling, 1 << 10, 4);
+    server.start();
+    size_t parent = server.add_task([&server]() {
+        for (int c = 0; c < 4; ++c) {
+            server.discard_result(server.add_task([c]() { return (double)c; }));
+        }
+        return 1.0;
+    });
+    bool ok = false;
+    try {
+        server.request_result(parent);
+    } catch (const std::length_error&) {
+        ok = true;
+    }
+    server.stop();
+    report(std::string("worker add_task into a full result table, ") + scheduling_names[scheduling], ok);
+}
+
+// Внешний клиент при полной таблице ждёт, пока результаты заберут
+void test_client_waits_for_capacity() {
+    TaskServer<double> server(2, SCHED_STEALING, 1 << 10, 4);
+    server.start();
+    for (int k = 0; k < 4; ++k) {
+        server.add_task([k]() { return (double)k; });
+    }
+    std::thread collector([&server]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        for (size_t id = 0; id < 4; ++id) {
+            server.request_result(id);
+        }
+    });
+    size_t id = server.add_task([]() { return 42.0; });
+    bool ok = id == 4 && server.request_result(id) == 42.0;
+    collector.join();
+    server.stop();
+    report("client add_task waits for a free result slot", ok);
+}
+
+// Общая очередь на 2 задачи: рабочий, которому не хватило места, выполняет
+// задачу сам, а не крутится, пока очередь не разгрузят
+void test_central_worker_full_ring() {
+    TaskServer<double> server(2, SCHED_CENTRAL, 2, 1 << 10);
+    server.start();
+    size_t parent = server.add_task([&server]() {
+        std::vector<size_t> ids;
+        for (int c = 0; c < 100; ++c) {
+            ids.push_back(server.add_task([c]() { return (double)c; }));
+        }
+        for (size_t id : ids) {
+            server.discard_result(id);
+        }
+        return 1.0;
+    });
+    bool ok = server.request_result(parent) == 1.0;
+    server.stop();
+    report("central worker add_task into a full ring", ok);
+}
+
+// Пачка больше result_capacity никогда не поместится: add_tasks сразу
+// бросает std::length_error, а пачка ровно в ёмкость проходит
+void test_batch_larger_than_capacity() {
+    TaskServer<double> server(2, SCHED_STEALING, 1 << 16, 16);
+    server.start();
+    std::vector<TaskServer<double>::Task> tasks;
+    for (int k = 0; k < 17; ++k) {
+        tasks.emplace_back([k]() { return (double)k; });
+    }
+    bool ok = false;
+    try {
+        server.add_tasks(tasks.begin(), tasks.end());
+    } catch (const std::length_error&) {
+        ok = true;
+    }
+
+    std::pair<size_t, size_t> ids = server.add_tasks(tasks.begin(), tasks.begin() + 16);
+    double sum = 0.0;
+    for (size_t id = ids.first; id < ids.second; ++id) {
+        sum += server.request_result(id);
+    }
+    ok = ok && sum == 120.0;
+    server.stop();
+    report("add_tasks batch larger than result_capacity", ok);
+}
+
+int main() {
+    start_watchdog(30);
+
+    test_worker_submission_when_full(SCHED_CENTRAL);
+    test_worker_submission_when_full(SCHED_STEALING);
+    test_client_waits_for_capacity();
+    test_central_worker_full_ring();
+    test_batch_larger_than_capacity();
+
+    if (failures > 0) {
+        std::cout << failures << " test(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
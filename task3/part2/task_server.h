@@ -0,0 +1,353 @@
+#ifndef TASK_SERVER_H
+#define TASK_SERVER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mpmc_queue.h"
+#include "result_table.h"
+#include "ws_deque.h"
+
+// Как рабочие потоки делят задачи:
+// CENTRAL - одна общая очередь MpmcQueue на всех;
+// STEALING - у каждого рабочего свой дек Чейза-Лева для задач, добавленных
+// из его же задач, и своя входная очередь, куда задачи внешних клиентов
+// раздаются по кругу. Рабочий берёт сначала из своего дека (последнюю
+// добавленную), потом из входной очереди, а когда своё кончилось, крадёт у
+// случайно выбранного соседа - из дека или из входной очереди.
+enum Scheduling { SCHED_CENTRAL, SCHED_STEALING };
+static constexpr const char* scheduling_names[] = {"central", "stealing"};
+
+// Задачи разбирают num_workers потоков. stop() дожидается, пока все очереди
+// опустеют, и только потом завершает рабочие потоки; задачи, добавленные
+// внешними клиентами после stop(), отвергаются, иначе их результата ждали бы
+// вечно. Задачи из рабочих потоков принимаются и во время stop(): это часть
+// работы, которую он дожидается. Задача не должна ждать результат другой
+// задачи - рабочий поток при этом просто блокируется.
+// Простаивающие рабочие спят на futex (Parker), и add_task делает системный
+// вызов, только если кто-то спит. Если входная очередь заполнена, внешний
+// клиент ждёт, пока рабочие её разгрузят; рабочий поток ждать не может (очередь
+// разгружают как раз рабочие), поэтому выполняет такую задачу сам, на месте.
+// Результаты лежат в ResultTable: request_result забирает результат и
+// освобождает его ячейку, discard_result отказывается от результата.
+// Ёмкость результатов: задач, которые ещё не выполнены или чей результат
+// никто не забрал, одновременно не больше result_capacity. Когда таблица
+// полна, внешний клиент ждёт в add_task, пока результаты не заберут; клиент,
+// который сам ничего не забирает, дождётся этого только от других клиентов.
+// Рабочий поток не ждёт никогда (ячейку может держать его же задача): его
+// add_task/add_tasks бросает std::length_error, и задача, если не поймает
+// исключение, завершается с ним. Пачка больше result_capacity не поместится
+// никогда, такой add_tasks бросает std::length_error сразу.
+template<typename T>
+class TaskServer {
+public:
+    using Task = std::function<T()>;
+
+    explicit TaskServer(size_t num_workers = std::max(1u, std::thread::hardware_concurrency()),
+                        Scheduling scheduling = SCHED_STEALING, size_t queue_capacity = 1 << 16,
+                        size_t result_capacity = 1 << 16)
+        : running(false), stopped(false), adding(0), next_queue(0),
+          num_workers(std::max<size_t>(num_workers, 1)), scheduling(scheduling), results(result_capacity) {
+        size_t num_queues = (scheduling == SCHED_STEALING) ? this->num_workers : 1;
+        for (size_t q = 0; q < num_queues; ++q) {
+            queues.emplace_back(new WorkerQueues(queue_capacity));
+        }
+    }
+
+    ~TaskServer() {
+        stop();
+        // Если сервер так и не запускали, задачи остались во входных очередях
+        for (auto& q : queues) {
+            TaskItem* item;
+            while (q->inbox.try_pop(item)) delete item;
+        }
+    }
+
+    void start() {
+        running = true;
+        for (size_t w = 0; w < num_workers; ++w) {
+            workers.emplace_back(&TaskServer::process_tasks, this, w);
+        }
+    }
+
+    void stop() {
+        // Сначала закрываем вход и ждём add_task, которые уже прошли проверку;
+        // после этого все задачи в очередях и рабочие могут выходить, опустошив их
+        stopped = true;
+        while (adding.load() != 0) {
+            std::this_thread::yield();
+        }
+        running = false;
+        parker.notify_all();
+        for (std::thread &worker : workers) {
+            if (worker.joinable()) worker.join();
+        }
+        workers.clear();
+    }
+
+    size_t add_task(Task task) {
+        size_t self = current_worker();
+        adding.fetch_add(1);
+        if (self == no_worker && stopped.load()) {
+            adding.fetch_sub(1);
+            throw std::logic_error("TaskServer: add_task after stop");
+        }
+
+        // Ячейка результата регистрируется до того, как id вернётся клиенту
+        size_t id = open_results(1, self);
+        TaskItem* item = new TaskItem{id, std::move(task)};
+        if (scheduling == SCHED_STEALING && self != no_worker) {
+            queues[self]->local.push(item);
+        } else {
+            size_t q = (scheduling == SCHED_STEALING) ? next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size() : 0;
+            while (!queues[q]->inbox.try_push(std::move(item))) {
+                if (self != no_worker) {
+                    run_task(item);
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+        adding.fetch_sub(1);
+        parker.notify_one();
+        return id;
+    }
+
+    // Добавляет задачи [first, last) одной пачкой, перемещая их из диапазона,
+    // и возвращает их id - полуинтервал [first_id, last_id). id выделяются
+    // одним CAS, во входную очередь задачи ложатся кусками по одному CAS
+    // на кусок, а будится не больше рабочих, чем задач в пачке
+    template <typename Iterator>
+    std::pair<size_t, size_t> add_tasks(Iterator first, Iterator last) {
+        size_t count = std::distance(first, last);
+        if (count > results.capacity()) {
+            throw std::length_error("TaskServer: batch is larger than result_capacity");
+        }
+        size_t self = current_worker();
+        adding.fetch_add(1);
+        if (self == no_worker && stopped.load()) {
+            adding.fetch_sub(1);
+            throw std::logic_error("TaskServer: add_tasks after stop");
+        }
+
+        size_t first_id = open_results(count, self);
+        std::vector<TaskItem*> items(count);
+        for (size_t k = 0; k < count; ++k, ++first) {
+            items[k] = new TaskItem{first_id + k, std::move(*first)};
+        }
+        if (scheduling == SCHED_STEALING && self != no_worker) {
+            for (TaskItem* item : items) {
+                queues[self]->local.push(item);
+            }
+        } else if (scheduling == SCHED_STEALING) {
+            // Пачка делится поровну на куски, куски раздаются по кругу
+            size_t num_chunks = std::min(count, queues.size());
+            size_t q = next_queue.fetch_add(num_chunks, std::memory_order_relaxed);
+            for (size_t c = 0; c < num_chunks; ++c) {
+                size_t begin = count * c / num_chunks, end = count * (c + 1) / num_chunks;
+                push_bulk(*queues[(q + c) % queues.size()], items.data() + begin, end - begin, false);
+            }
+        } else {
+            push_bulk(*queues[0], items.data(), count, self != no_worker);
+        }
+        adding.fetch_sub(1);
+        if (count > 0) {
+            parker.notify((int)std::min(count, num_workers));
+        }
+        return {first_id, first_id + count};
+    }
+
+    // Ждёт результат и забирает его; каждый id можно запросить один раз
+    T request_result(size_t id) {
+        if (id >= results.opened()) {
+            throw std::out_of_range("TaskServer: unknown task id");
+        }
+        return results.take(id);
+    }
+
+    void discard_result(size_t id) {
+        if (id >= results.opened()) {
+            throw std::out_of_range("TaskServer: unknown task id");
+        }
+        results.discard(id);
+    }
+
+    size_t workers_count() const {
+        return num_workers;
+    }
+
+    size_t result_capacity() const {
+        return results.capacity();
+    }
+
+private:
+    struct TaskItem {
+        size_t id;
+        Task task;
+    };
+
+    struct WorkerQueues {
+        explicit WorkerQueues(size_t capacity) : inbox(capacity) {}
+
+        MpmcQueue<TaskItem*> inbox;    // Задачи внешних клиентов
+        ChaseLevDeque<TaskItem> local; // Задачи, добавленные из задач этого рабочего
+    };
+
+    // Какой рабочий поток какого сервера выполняется в текущем потоке
+    struct WorkerContext {
+        const TaskServer* server;
+        size_t index;
+    };
+
+    static WorkerContext& context() {
+        static thread_local WorkerContext ctx{nullptr, 0};
+        return ctx;
+    }
+
+    size_t current_worker() const {
+        const WorkerContext& ctx = context();
+        return ctx.server == this ? ctx.index : no_worker;
+    }
+
+    // Выделяет id count задачам. Таблица результатов полна: внешний клиент
+    // ждёт, рабочий поток получает std::length_error (см. комментарий к классу).
+    // Вызывается между adding.fetch_add и adding.fetch_sub
+    size_t open_results(size_t count, size_t self) {
+        size_t first_id;
+        while (!results.try_open(count, &first_id)) {
+            if (self != no_worker) {
+                adding.fetch_sub(1);
+                throw std::length_error("TaskServer: result table is full");
+            }
+            std::this_thread::yield();
+        }
+        return first_id;
+    }
+
+    // Очередь заполнена: внешний клиент ждёт, рабочий (run_inline)
+    // выполняет очередную задачу сам и пробует снова
+    void push_bulk(WorkerQueues& queue, TaskItem** items, size_t count, bool run_inline) {
+        while (count > 0) {
+            size_t pushed = queue.inbox.try_push_bulk(items, count);
+            if (pushed == 0) {
+                if (run_inline) {
+                    run_task(*items);
+                    pushed = 1;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            items += pushed;
+            count -= pushed;
+        }
+    }
+
+    // Выполняет задачу, публикует результат или исключение и удаляет её
+    void run_task(TaskItem* item) {
+        try {
+            T result = item->task();
+            results.set_value(item->id, std::move(result));
+        } catch (...) {
+            results.set_exception(item->id, std::current_exception());
+        }
+        delete item;
+    }
+
+    // Своё: сначала дек, потом входная очередь. Дек принадлежит одному
+    // рабочему, поэтому в SCHED_CENTRAL, где очередь общая, он не трогается
+    TaskItem* take_own(size_t own) {
+        TaskItem* item = (scheduling == SCHED_STEALING) ? queues[own]->local.take() : nullptr;
+        if (!item && !queues[own]->inbox.try_pop(item)) item = nullptr;
+        return item;
+    }
+
+    TaskItem* steal_from(size_t victim) {
+        TaskItem* item = queues[victim]->local.steal();
+        if (!item && !queues[victim]->inbox.try_pop(item)) item = nullptr;
+        return item;
+    }
+
+    // Своё, а если пусто - одна попытка кражи у случайного соседа
+    TaskItem* find_task(size_t own, std::minstd_rand& rng) {
+        TaskItem* item = take_own(own);
+        if (!item && queues.size() > 1) {
+            size_t victim = rng() % (queues.size() - 1);
+            if (victim >= own) ++victim;
+            item = steal_from(victim);
+        }
+        return item;
+    }
+
+    // Перед сном и перед выходом просматриваются все очереди
+    TaskItem* scan_all(size_t own) {
+        TaskItem* item = take_own(own);
+        for (size_t k = 1; !item && k < queues.size(); ++k) {
+            item = steal_from((own + k) % queues.size());
+        }
+        return item;
+    }
+
+    void process_tasks(size_t self) {
+        context() = WorkerContext{this, self};
+        size_t own = (scheduling == SCHED_STEALING) ? self : 0;
+        std::minstd_rand rng(self + 1);
+
+        while (true) {
+            TaskItem* item = nullptr;
+            for (int spin = 0; spin < spin_limit && !item; ++spin) {
+                item = find_task(own, rng);
+            }
+            if (!item) {
+                // Эпоха берётся до перепроверки очередей и running, поэтому
+                // push или stop() после неё разбудят поток или не дадут ему уснуть
+                uint32_t key = parker.prepare_wait();
+                item = scan_all(own);
+                if (item) {
+                    parker.cancel_wait();
+                } else if (running.load()) {
+                    parker.wait(key);
+                    continue;
+                } else {
+                    parker.cancel_wait();
+                    // running сбрасывается после последнего внешнего add_task, так
+                    // что всё добавленное клиентами уже видно; в свой дек кладёт
+                    // только сам поток, так что пустые свои очереди значат, что
+                    // его работа кончилась. Чужие деки дорабатывают их владельцы
+                    item = scan_all(own);
+                    if (!item) break;
+                }
+            }
+
+            run_task(item);
+        }
+
+        context() = WorkerContext{nullptr, 0};
+    }
+
+    static const int spin_limit = 64;
+    static const size_t no_worker = static_cast<size_t>(-1);
+
+    std::atomic<bool> running;
+    std::atomic<bool> stopped;
+    std::atomic<int> adding;
+    std::atomic<size_t> next_queue;
+    size_t num_workers;
+    Scheduling scheduling;
+    std::vector<std::thread> workers;
+
+    std::vector<std::unique_ptr<WorkerQueues>> queues;
+    Parker parker;
+    ResultTable<T> results;
+};
+
+#endif
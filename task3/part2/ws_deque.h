@@ -0,0 +1,109 @@
+#ifndef WS_DEQUE_H
+#define WS_DEQUE_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Дек Чейза-Лева для планировщика с кражей работы. Владелец кладёт и берёт
+// задачи с нижнего конца (push/take, LIFO), остальные потоки крадут с
+// верхнего (steal, FIFO). Владельцу нужен CAS только за последний элемент;
+// воры соревнуются между собой через CAS на top. Хранятся указатели: вор
+// читает ячейку до CAS и при неудаче просто выбрасывает прочитанное.
+// Кольцо удваивается при заполнении; старые массивы живут до разрушения дека,
+// потому что вор мог успеть прочитать указатель на них. Порядки памяти - из
+// C11-версии алгоритма (Lê, Pop, Cohen, Zappa Nardelli, PPoPP 2013).
+// Начальная ёмкость - степень двойки.
+template <typename T>
+class ChaseLevDeque {
+public:
+    explicit ChaseLevDeque(size_t capacity = 1024) : top(0), bottom(0) {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+        arrays.emplace_back(new Array(capacity));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    // Только владелец
+    void push(T* value) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Array* a = array.load(std::memory_order_relaxed);
+        if (b - t > (int64_t)a->mask) {
+            a = grow(a, t, b);
+        }
+        a->put(b, value);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // Только владелец; nullptr, если дек пуст
+    T* take() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* value = a->get(b);
+        if (t == b) {
+            // Последний элемент: владелец соревнуется с ворами за top
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                value = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return value;
+    }
+
+    // Любой поток; nullptr, только если дек был пуст. Проигранный CAS значит,
+    // что элемент забрал кто-то другой, и вор пробует следующий
+    T* steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        while (true) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom.load(std::memory_order_acquire);
+            if (t >= b) return nullptr;
+            Array* a = array.load(std::memory_order_acquire);
+            T* value = a->get(t);
+            if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return value;
+            }
+        }
+    }
+
+private:
+    struct Array {
+        explicit Array(size_t capacity) : mask(capacity - 1), cells(new std::atomic<T*>[capacity]) {}
+
+        T* get(int64_t i) const { return cells[i & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, T* value) { cells[i & mask].store(value, std::memory_order_relaxed); }
+
+        const size_t mask;
+        std::unique_ptr<std::atomic<T*>[]> cells;
+    };
+
+    Array* grow(Array* a, int64_t t, int64_t b) {
+        arrays.emplace_back(new Array(2 * (a->mask + 1)));
+        Array* bigger = arrays.back().get();
+        for (int64_t i = t; i < b; ++i) {
+            bigger->put(i, a->get(i));
+        }
+        array.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<Array*> array;
+    std::vector<std::unique_ptr<Array>> arrays;  // Меняет только владелец
+};
+
+#endif